@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "measurement.hpp"
+#include "stationmeasurements.hpp"
+#include "measurementfilter.hpp"
+#include "datacompleteness.hpp"
+#include "monthlyaggregates.hpp"
+#include "yearseries.hpp"
+#include "mappedfile.hpp"
+#include "binarycache.hpp"
+#include "gzipreader.hpp"
+
+
+// Series are stored in the in-memory format and copied back as they are.
+static_assert(std::is_trivially_copyable_v<Measurement> && sizeof(Measurement) == 8, "Sidecar layout depends on Measurement");
+
+
+bool
+BinaryCache::read(const std::string& cacheFilename, const std::string& sourceFilename, StationMeasurements& measurements,
+                  const MeasurementFilter* filter)
+{
+    std::array<std::vector<Measurement>, StationMeasurements::s_numTypes> series;
+    std::vector<TypeSeries> directory;
+    const bool valid = readSections(cacheFilename, sourceFilename, [&](std::string_view data, const Header& header) {
+        if (!copySection(data, header.typeOffset, header.typeCount, directory)) {
+            return false;
+        }
+        for (const TypeSeries& entry : directory) {
+            if (entry.type >= StationMeasurements::s_numTypes || entry.offset > data.size() ||
+                entry.count > (data.size() - entry.offset) / sizeof(Measurement)) {
+                return false;  // Truncated or corrupt
+            }
+            const auto type = static_cast<MeasurementType>(entry.type);
+            if (filter != nullptr && !filter->acceptsType(type)) {
+                continue;
+            }
+            // The mapping is page aligned and the offsets are 8 byte aligned.
+            std::span<const Measurement> stored(reinterpret_cast<const Measurement*>(data.data() + entry.offset), entry.count);
+            if (filter != nullptr) {
+                stored = yearWindow(stored, filter->firstYear(type), filter->lastYear(type));
+            }
+            series[entry.type].assign(stored.begin(), stored.end());
+        }
+        return true;
+    });
+    if (!valid) {
+        return false;
+    }
+    measurements = StationMeasurements(std::move(series));
+    return true;
+}
+
+
+bool
+BinaryCache::readCompleteness(const std::string& cacheFilename, const std::string& sourceFilename, DataCompleteness& completeness)
+{
+    // Only the pages of the bitmaps are touched, the measurement series stay on disk.
+    DataCompleteness loaded;
+    const bool valid = readSections(cacheFilename, sourceFilename, [&loaded](std::string_view data, const Header& header) {
+        return copySection(data, header.seriesOffset, header.seriesCount, loaded.m_series) &&
+               copySection(data, header.wordOffset, header.wordCount, loaded.m_words) &&
+               YearSeries::fits(loaded.m_series, DataCompleteness::s_wordsPerYear, 0, loaded.m_words.size());
+    });
+    if (!valid) {
+        return false;
+    }
+    completeness = std::move(loaded);
+    return true;
+}
+
+
+bool
+BinaryCache::readAggregates(const std::string& cacheFilename, const std::string& sourceFilename, MonthlyAggregates& aggregates)
+{
+    // Only the pages of the totals are touched, the measurement series stay on disk.
+    MonthlyAggregates loaded;
+    const bool valid = readSections(cacheFilename, sourceFilename, [&loaded](std::string_view data, const Header& header) {
+        return copySection(data, header.aggregateSeriesOffset, header.aggregateSeriesCount, loaded.m_series) &&
+               copySection(data, header.sumOffset, header.aggregateEntryCount, loaded.m_sums) &&
+               copySection(data, header.countOffset, header.aggregateEntryCount, loaded.m_counts) &&
+               YearSeries::fits(loaded.m_series, 12, 1, loaded.m_sums.size());
+    });
+    if (!valid) {
+        return false;
+    }
+    aggregates = std::move(loaded);
+    return true;
+}
+
+
+bool
+BinaryCache::write(const std::string& cacheFilename, const std::string& sourceFilename, const StationMeasurements& measurements)
+{
+    Header header;
+    std::memcpy(header.magic, s_magic, sizeof(s_magic));
+    header.version = s_version;
+    header.byteOrder = s_byteOrder;
+    if (!statSource(sourceFilename, header)) {
+        return false;
+    }
+    header.sourceHash = hashSource(sourceFilename);
+    header.count = measurements.size();
+    std::vector<TypeSeries> directory;
+    for (std::size_t typeIndex = 0; typeIndex < StationMeasurements::s_numTypes; ++typeIndex) {
+        const std::size_t count = measurements.series(static_cast<MeasurementType>(typeIndex)).size();
+        if (count > 0) {
+            directory.push_back(TypeSeries{typeIndex, count, 0});
+        }
+    }
+    header.typeCount = directory.size();
+    header.typeOffset = alignUp(sizeof(Header));
+    std::uint64_t offset = alignUp(header.typeOffset + header.typeCount * sizeof(TypeSeries));
+    for (TypeSeries& entry : directory) {
+        entry.offset = offset;
+        offset = alignUp(offset + entry.count * sizeof(Measurement));
+    }
+    const DataCompleteness completeness(measurements);
+    header.seriesCount = completeness.m_series.size();
+    header.seriesOffset = offset;
+    header.wordCount = completeness.m_words.size();
+    header.wordOffset = alignUp(header.seriesOffset + header.seriesCount * sizeof(YearSeries));
+    const MonthlyAggregates aggregates(measurements);
+    header.aggregateSeriesCount = aggregates.m_series.size();
+    header.aggregateSeriesOffset = alignUp(header.wordOffset + header.wordCount * sizeof(std::uint64_t));
+    header.aggregateEntryCount = aggregates.m_sums.size();
+    header.sumOffset = alignUp(header.aggregateSeriesOffset + header.aggregateSeriesCount * sizeof(YearSeries));
+    header.countOffset = alignUp(header.sumOffset + header.aggregateEntryCount * sizeof(std::int64_t));
+    const std::uint64_t fileSize = alignUp(header.countOffset + header.aggregateEntryCount * sizeof(std::uint32_t));
+
+    // Build the complete image in memory and write it with a single call.
+    std::vector<char> image(fileSize, 0);
+    std::memcpy(image.data(), &header, sizeof(Header));
+    std::memcpy(image.data() + header.typeOffset, directory.data(), header.typeCount * sizeof(TypeSeries));
+    for (const TypeSeries& entry : directory) {
+        std::memcpy(image.data() + entry.offset, measurements.series(static_cast<MeasurementType>(entry.type)).data(),
+                    entry.count * sizeof(Measurement));
+    }
+    std::memcpy(image.data() + header.seriesOffset, completeness.m_series.data(), header.seriesCount * sizeof(YearSeries));
+    std::memcpy(image.data() + header.wordOffset, completeness.m_words.data(), header.wordCount * sizeof(std::uint64_t));
+    std::memcpy(image.data() + header.aggregateSeriesOffset, aggregates.m_series.data(),
+                header.aggregateSeriesCount * sizeof(YearSeries));
+    std::memcpy(image.data() + header.sumOffset, aggregates.m_sums.data(), header.aggregateEntryCount * sizeof(std::int64_t));
+    std::memcpy(image.data() + header.countOffset, aggregates.m_counts.data(), header.aggregateEntryCount * sizeof(std::uint32_t));
+
+    const std::string tmpFilename = cacheFilename + ".tmp";
+    std::error_code ec;
+    {
+        std::ofstream outStream{tmpFilename, std::ios::out | std::ios::binary | std::ios::trunc};
+        if (!outStream) {
+            return false;  // e. g. read-only data directory
+        }
+        outStream.write(image.data(), static_cast<std::streamsize>(image.size()));
+        if (!outStream) {
+            outStream.close();
+            std::filesystem::remove(tmpFilename, ec);  // Best effort, the write has failed anyway
+            return false;
+        }
+    }
+    std::filesystem::rename(tmpFilename, cacheFilename, ec);
+    if (ec) {
+        std::filesystem::remove(tmpFilename, ec);
+        return false;
+    }
+    return true;
+}
+
+
+std::string
+BinaryCache::cacheFilenameFor(const std::string& sourceFilename)
+{
+    std::filesystem::path path(sourceFilename);
+    if (GzipReader::isGzipFilename(sourceFilename)) {
+        path.replace_extension();  // GME00102380.csv.gz => GME00102380.csv
+    }
+    return path.replace_extension(".ghcnbin").string();
+}
+
+
+bool
+BinaryCache::readHeader(std::string_view data, const std::string& sourceFilename, Header& header)
+{
+    if (data.size() < sizeof(Header)) {
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(Header));
+    if (std::memcmp(header.magic, s_magic, sizeof(s_magic)) != 0 ||
+        header.version != s_version ||
+        header.byteOrder != s_byteOrder) {
+        return false;
+    }
+
+    // Sidecar must belong to the current state of the source file. Same size and time: unchanged, the
+    // source is not read. Same size, other time (e. g. copied or touched): compare the hashes.
+    Header source;
+    if (!statSource(sourceFilename, source) || source.sourceSize != header.sourceSize) {
+        return false;
+    }
+    return source.sourceMtime == header.sourceMtime || hashSource(sourceFilename) == header.sourceHash;
+}
+
+
+template <typename SectionReader>
+bool
+BinaryCache::readSections(const std::string& cacheFilename, const std::string& sourceFilename, SectionReader&& sections)
+{
+    MappedFile mappedFile(cacheFilename);
+    if (!mappedFile.isValid()) {
+        return false;  // No sidecar yet
+    }
+    const std::string_view data = mappedFile.view();
+    Header header;
+    return readHeader(data, sourceFilename, header) && sections(data, header);
+}
+
+
+template <typename T>
+bool
+BinaryCache::copySection(std::string_view data, std::uint64_t offset, std::uint64_t count, std::vector<T>& section)
+{
+    if (offset > data.size() || count > (data.size() - offset) / sizeof(T)) {
+        return false;  // Truncated
+    }
+    section.resize(count);
+    std::memcpy(section.data(), data.data() + offset, count * sizeof(T));
+    return true;
+}
+
+
+bool
+BinaryCache::statSource(const std::string& sourceFilename, Header& header)
+{
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(sourceFilename, ec);
+    if (ec) {
+        return false;
+    }
+    const auto mtime = std::filesystem::last_write_time(sourceFilename, ec);
+    if (ec) {
+        return false;
+    }
+    header.sourceSize = size;
+    header.sourceMtime = static_cast<std::int64_t>(mtime.time_since_epoch().count());
+    return true;
+}
+
+
+std::uint64_t
+BinaryCache::hashSource(const std::string& sourceFilename)
+{
+    // The whole file: an edit anywhere may keep the size (e. g. a corrected value). Eight bytes per
+    // step, so hashing costs a fraction of a parse. Only needed when writing and when the time differs.
+    std::uint64_t hash = 14695981039346656037ull;
+    MappedFile mappedFile(sourceFilename);
+    if (mappedFile.isValid()) {
+        const std::string_view data = mappedFile.view();
+        std::size_t i{0};
+        for (; i + sizeof(std::uint64_t) <= data.size(); i += sizeof(std::uint64_t)) {
+            std::uint64_t word;
+            std::memcpy(&word, data.data() + i, sizeof(word));
+            hash ^= word;
+            hash *= 1099511628211ull;
+        }
+        for (; i < data.size(); ++i) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+
+std::span<const Measurement>
+BinaryCache::yearWindow(std::span<const Measurement> series, int firstYear, int lastYear)
+{
+    auto begin = std::ranges::partition_point(series, [firstYear](const Measurement& m) {return m.getYear() < firstYear;});
+    auto end = std::ranges::partition_point(begin, series.end(), [lastYear](const Measurement& m) {return m.getYear() <= lastYear;});
+    return std::span<const Measurement>(begin, end);
+}
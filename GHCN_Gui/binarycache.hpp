@@ -0,0 +1,117 @@
+#ifndef BINARYCACHE_HPP
+#define BINARYCACHE_HPP
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "measurement.hpp"
+#include "stationmeasurements.hpp"
+#include "measurementfilter.hpp"
+#include "datacompleteness.hpp"
+#include "monthlyaggregates.hpp"
+
+/*
+    Binary sidecar for a parsed station file (e. g. GME00102380.ghcnbin next to GME00102380.csv).
+
+    Layout (native byte order, all offsets relative to file start and 8 byte aligned):
+
+    Header
+    directory      type count x TypeSeries (type, number of measurements, offset)
+    series         per type with measurements: count x Measurement, ascending by date
+    completeness   series count x YearSeries, then word count x uint64 (bitmaps)
+    aggregates     series count x YearSeries, then entry count x int64 (sums)
+                   and entry count x uint32 (counts)
+
+    Series are stored in the 8 byte in-memory format of Measurement, so loading a type is a block
+    copy of its selected years into StationMeasurements, with no decoding and no partitioning.
+
+    The header stores size, modification time and a hash of the source file. A source with the
+    recorded size and time is taken as unchanged without reading it; only a source with the same
+    size but another time is hashed completely. A sidecar whose source has changed is rejected and
+    rewritten after the next parse.
+    Increment s_version whenever the layout, Measurement or MeasurementType changes.
+*/
+
+class BinaryCache
+{
+public:
+    // Loads measurements from cacheFilename if it is valid for sourceFilename. Returns false otherwise.
+    // With a filter, only the selected types and years are loaded (nullptr: all measurements).
+    static bool read(const std::string& cacheFilename, const std::string& sourceFilename, StationMeasurements& measurements,
+                     const MeasurementFilter* filter = nullptr);
+
+    // Loads only the completeness bitmaps from cacheFilename if it is valid for sourceFilename. Returns false otherwise.
+    static bool readCompleteness(const std::string& cacheFilename, const std::string& sourceFilename, DataCompleteness& completeness);
+
+    // Loads only the monthly sums and counts from cacheFilename if it is valid for sourceFilename. Returns false otherwise.
+    static bool readAggregates(const std::string& cacheFilename, const std::string& sourceFilename, MonthlyAggregates& aggregates);
+
+    // Writes the sidecar including completeness bitmaps and monthly aggregates (via a temporary file, so
+    // readers never see a partial file). Returns false on failure.
+    static bool write(const std::string& cacheFilename, const std::string& sourceFilename, const StationMeasurements& measurements);
+
+    // Source with extension replaced by .ghcnbin. Compressed and plain sources share the sidecar name.
+    static std::string cacheFilenameFor(const std::string& sourceFilename);
+
+private:
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byteOrder;
+        std::uint64_t sourceSize;
+        std::int64_t sourceMtime;
+        std::uint64_t sourceHash;
+        std::uint64_t count;
+        std::uint64_t typeCount;
+        std::uint64_t typeOffset;
+        std::uint64_t seriesCount;
+        std::uint64_t seriesOffset;
+        std::uint64_t wordCount;
+        std::uint64_t wordOffset;
+        std::uint64_t aggregateSeriesCount;
+        std::uint64_t aggregateSeriesOffset;
+        std::uint64_t aggregateEntryCount;
+        std::uint64_t sumOffset;
+        std::uint64_t countOffset;
+    };
+
+    struct TypeSeries
+    {
+        std::uint64_t type;  // MeasurementType
+        std::uint64_t count;
+        std::uint64_t offset;
+    };
+
+    static constexpr char s_magic[8] = {'G', 'H', 'C', 'N', 'B', 'I', 'N', '\0'};
+    static constexpr std::uint32_t s_version{5};
+    static constexpr std::uint32_t s_byteOrder{0x01020304};
+
+    // Checks magic, version and source of the mapped sidecar and copies its header. Returns false if it does not match.
+    static bool readHeader(std::string_view data, const std::string& sourceFilename, Header& header);
+
+    // Fills size and mtime of the source file. Returns false if the source is not accessible.
+    static bool statSource(const std::string& sourceFilename, Header& header);
+
+    // FNV-1a over the whole source file, in 8 byte words.
+    static std::uint64_t hashSource(const std::string& sourceFilename);
+
+    // Measurements of series (ascending by date) from firstYear to lastYear.
+    static std::span<const Measurement> yearWindow(std::span<const Measurement> series, int firstYear, int lastYear);
+
+    // Maps the sidecar, checks its header and calls sections(data, header) to copy what is needed from
+    // the mapping. Returns false if the sidecar is missing or invalid, or if sections does.
+    template <typename SectionReader>
+    static bool readSections(const std::string& cacheFilename, const std::string& sourceFilename, SectionReader&& sections);
+
+    // Copies count elements at offset of the mapped sidecar into section. Returns false if they are not inside data.
+    template <typename T>
+    static bool copySection(std::string_view data, std::uint64_t offset, std::uint64_t count, std::vector<T>& section);
+
+    static std::uint64_t alignUp(std::uint64_t offset) {return (offset + 7) & ~std::uint64_t{7};};
+};
+
+#endif // BINARYCACHE_HPP
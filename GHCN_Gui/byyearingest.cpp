@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <future>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "measurement.hpp"
+#include "measurementparser.hpp"
+#include "stationmeasurements.hpp"
+#include "mappedfile.hpp"
+#include "gzipreader.hpp"
+#include "binarycache.hpp"
+#include "byyearingest.hpp"
+
+
+ByYearIngest::ByYearIngest(const std::string& outputDirName, std::size_t memoryBudget)
+    : m_outputDir(outputDirName),
+    m_spillDir(m_outputDir / ".by_year_spill"),
+    m_memoryBudget(memoryBudget),
+    m_partitions(s_numPartitions)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(m_outputDir, ec);
+    std::filesystem::remove_all(m_spillDir, ec);  // Left over from an aborted run
+}
+
+
+ByYearIngest::~ByYearIngest()
+{
+    std::error_code ec;
+    std::filesystem::remove_all(m_spillDir, ec);
+}
+
+
+bool
+ByYearIngest::addFile(const std::string& filename)
+{
+    if (GzipReader::isGzipFilename(filename)) {
+        // GzipReader delivers 1 MiB blocks. Collect them, so partitioning can use all cores.
+        std::string batch;
+        const bool complete = GzipReader::readLines(filename, [this, &batch](std::string_view text) {
+            batch.append(text);
+            if (batch.size() >= s_blockSize) {
+                partition(batch);
+                batch.clear();
+            }
+        });
+        partition(batch);
+        return complete && !m_spillFailed;
+    }
+
+    MappedFile mappedFile(filename);
+    if (!mappedFile.isValid()) {
+        return false;
+    }
+    mappedFile.adviseSequential();
+    const std::string_view text = mappedFile.view();
+    const auto numBlocks = static_cast<unsigned>(std::max<std::size_t>(1, text.size() / s_blockSize));
+    for (std::string_view block : MeasurementParser::splitAtLineBreaks(text, numBlocks)) {
+        partition(block);
+    }
+    return !m_spillFailed;
+}
+
+
+bool
+ByYearIngest::finish()
+{
+    // Workers take buckets one by one, so a few large buckets do not leave the others idle.
+    const unsigned numWorkers = std::clamp(std::thread::hardware_concurrency(), 1u, static_cast<unsigned>(s_numPartitions));
+    std::atomic<std::size_t> nextPartition{0};
+    std::vector<std::future<std::pair<bool, std::size_t>>> workers;
+    for (unsigned i = 0; i < numWorkers; ++i) {
+        workers.push_back(std::async(std::launch::async, [this, &nextPartition]() {
+            bool success{true};
+            std::size_t stationCount{0};
+            for (std::size_t index = nextPartition++; index < s_numPartitions; index = nextPartition++) {
+                success = writePartition(index, stationCount) && success;
+            }
+            return std::pair(success, stationCount);
+        }));
+    }
+    bool success = !m_spillFailed;
+    for (auto& worker : workers) {
+        const auto [workerSuccess, stationCount] = worker.get();
+        success = success && workerSuccess;
+        m_stationCount += stationCount;
+    }
+    m_bufferedBytes = 0;
+
+    std::error_code ec;
+    std::filesystem::remove_all(m_spillDir, ec);
+    return success;
+}
+
+
+void
+ByYearIngest::partition(std::string_view text)
+{
+    // Rows of one chunk, sorted into buckets. Lines without a valid station ID are dropped here.
+    auto partitionChunk = [](std::string_view chunk) {
+        std::pair<std::vector<std::string>, std::size_t> result{std::vector<std::string>(s_numPartitions), 0};
+        auto& [buckets, rowCount] = result;
+        std::size_t pos = 0;
+        while (pos < chunk.size()) {
+            std::size_t eol = chunk.find('\n', pos);
+            if (eol == std::string_view::npos) {
+                eol = chunk.size();  // Last line without line break
+            }
+            std::string_view line = chunk.substr(pos, eol - pos);
+            pos = eol + 1;
+            if (line.ends_with('\r')) {
+                line.remove_suffix(1);
+            }
+            const std::size_t comma = line.find(',');
+            if (comma == 0 || comma == std::string_view::npos) {
+                continue;
+            }
+            const std::string_view stationId = line.substr(0, comma);
+            // The ID becomes a file name. Accept nothing that could leave the output directory, and only the
+            // characters of StationKey: lowercase IDs would collide with uppercase ones on case-insensitive file systems.
+            if (!std::ranges::all_of(stationId, [](char c) {return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z');})) {
+                continue;
+            }
+            std::string& bucket = buckets[partitionOf(stationId)];
+            bucket.append(line);
+            bucket.push_back('\n');
+            ++rowCount;
+        }
+        return result;
+    };
+
+    const std::vector<std::string_view> chunks =
+        MeasurementParser::splitAtLineBreaks(text, MeasurementParser::chunkCountForSize(text.size()));
+    std::vector<std::future<std::pair<std::vector<std::string>, std::size_t>>> results;
+    for (std::string_view chunk : chunks) {
+        results.push_back(std::async(chunks.size() > 1 ? std::launch::async : std::launch::deferred, partitionChunk, chunk));
+    }
+    // Append in chunk order => rows of a station stay in input order.
+    for (auto& result : results) {
+        const auto [buckets, rowCount] = result.get();
+        for (std::size_t i = 0; i < s_numPartitions; ++i) {
+            m_partitions[i].append(buckets[i]);
+            m_bufferedBytes += buckets[i].size();
+        }
+        m_rowCount += rowCount;
+    }
+    if (m_bufferedBytes > m_memoryBudget) {
+        spill();
+    }
+}
+
+
+bool
+ByYearIngest::spill()
+{
+    std::error_code ec;
+    std::filesystem::create_directories(m_spillDir, ec);
+    for (std::size_t i = 0; i < s_numPartitions; ++i) {
+        std::string& bucket = m_partitions[i];
+        if (bucket.empty()) {
+            continue;
+        }
+        std::ofstream outStream{spillFilename(i), std::ios::out | std::ios::binary | std::ios::app};
+        outStream.write(bucket.data(), static_cast<std::streamsize>(bucket.size()));
+        if (!outStream) {
+            m_spillFailed = true;  // e. g. disk full. Keep the rows, finish() reports the failure.
+            return false;
+        }
+        m_bufferedBytes -= bucket.size();
+        bucket.clear();  // Capacity is kept for the next round.
+    }
+    ++m_spillCount;
+    return true;
+}
+
+
+bool
+ByYearIngest::writePartition(std::size_t index, std::size_t& stationCount)
+{
+    struct Row
+    {
+        std::string_view stationId;
+        std::uint32_t date;  // YYYYMMDD, 0 if malformed
+        std::string_view line;
+    };
+    std::vector<Row> rows;
+    auto collectRows = [&rows](std::string_view text) {
+        std::size_t pos = 0;
+        while (pos < text.size()) {
+            const std::size_t eol = text.find('\n', pos);  // Every buffered row ends with a line break.
+            const std::string_view line = text.substr(pos, eol - pos);
+            pos = eol + 1;
+            const std::size_t comma = line.find(',');
+            std::uint32_t date{0};
+            if (line.size() >= comma + 9) {
+                std::from_chars(line.data() + comma + 1, line.data() + comma + 9, date);
+            }
+            rows.push_back(Row{line.substr(0, comma), date, line});
+        }
+    };
+
+    // Rows from the spill file come first, they were read earlier.
+    MappedFile spilled(spillFilename(index).string());
+    if (spilled.isValid()) {
+        collectRows(spilled.view());
+    }
+    collectRows(m_partitions[index]);
+
+    // Stable: rows of the same station and date keep their input order.
+    std::ranges::stable_sort(rows, [](const Row& r1, const Row& r2) {
+        return std::tie(r1.stationId, r1.date) < std::tie(r2.stationId, r2.date);
+    });
+
+    bool success{true};
+    std::string text;
+    for (auto first = rows.begin(); first != rows.end();) {
+        auto last = std::find_if(first, rows.end(), [first](const Row& row) {return row.stationId != first->stationId;});
+        text.clear();
+        for (auto row = first; row != last; ++row) {
+            text.append(row->line);
+            text.push_back('\n');
+        }
+        success = writeStation(first->stationId, text) && success;
+        ++stationCount;
+        first = last;
+    }
+    std::string().swap(m_partitions[index]);  // Release the bucket, rows point into it up to here.
+    return success;
+}
+
+
+bool
+ByYearIngest::writeStation(std::string_view stationId, const std::string& text)
+{
+    const std::string filename = (m_outputDir / std::format("{}.csv", stationId)).string();
+    const std::string tmpFilename = filename + ".tmp";
+    {
+        std::ofstream outStream{tmpFilename, std::ios::out | std::ios::binary | std::ios::trunc};
+        outStream.write(text.data(), static_cast<std::streamsize>(text.size()));
+        if (!outStream) {
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpFilename, filename, ec);
+    if (ec) {
+        std::filesystem::remove(tmpFilename, ec);
+        return false;
+    }
+
+    // The text is at hand, so the sidecar costs a parse but no read.
+    std::vector<Measurement> measurements;
+    MeasurementParser::parseCsv(text, measurements);
+    const StationMeasurements stationMeasurements(measurements);
+    if (!stationMeasurements.empty()) {
+        BinaryCache::write(BinaryCache::cacheFilenameFor(filename), filename, stationMeasurements);  // Failure is not an error.
+    }
+    return true;
+}
+
+
+std::filesystem::path
+ByYearIngest::spillFilename(std::size_t index) const
+{
+    return m_spillDir / std::format("{:03}.csv", index);
+}
+
+
+std::size_t
+ByYearIngest::partitionOf(std::string_view stationId)
+{
+    // FNV-1a. Station IDs share long prefixes (country, network), so all characters are hashed.
+    std::uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : stationId) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return static_cast<std::size_t>(hash % s_numPartitions);
+}
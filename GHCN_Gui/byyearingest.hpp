@@ -0,0 +1,83 @@
+#ifndef BYYEARINGEST_HPP
+#define BYYEARINGEST_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+    Rebuild of the per-station store from by_year files (e. g. 2023.csv.gz: all stations, one year).
+
+    by_year rows have the layout of the per-station CSV files (see MeasurementParser), but the
+    rows of a station are spread over the whole file and over one file per year. The ingest
+    transposes them:
+
+    1. Partition: input text is read in large blocks (gzip files through GzipReader, so inflating
+       overlaps with partitioning). Each block is split into chunks which are partitioned
+       concurrently by a hash of the station ID into s_numPartitions buckets. The chunk results are
+       appended in input order, so the rows of a station keep their order.
+    2. Spill: when the buffered text exceeds the memory budget, every bucket is appended to its
+       spill file in the output directory and emptied.
+    3. finish(): buckets are processed concurrently. Each bucket (spill file plus buffered rest)
+       is sorted by station and date and written as one <ID>.csv per station, followed by its
+       binary sidecar, so DataProvider never has to parse the new files.
+
+    Rows are copied as they are, flags and observation time included. Station files in the output
+    directory are replaced: an ingest is a rebuild from the given by_year files, not an update of
+    existing station files. Use a directory of its own, DataProvider picks the latest file per
+    station by name.
+*/
+class ByYearIngest
+{
+public:
+    // memoryBudget: bytes of row text buffered before spilling to disk.
+    ByYearIngest(const std::string& outputDirName, std::size_t memoryBudget);
+
+    // Removes the spill files.
+    ~ByYearIngest();
+
+    ByYearIngest(const ByYearIngest&) = delete;
+    ByYearIngest& operator=(const ByYearIngest&) = delete;
+
+    // Reads a by_year file (.csv or .csv.gz). Returns false if it cannot be read completely.
+    bool addFile(const std::string& filename);
+
+    // Writes all station files and sidecars. Returns false if any of them could not be written.
+    bool finish();
+
+    std::size_t rowCount() const {return m_rowCount;};
+    std::size_t stationCount() const {return m_stationCount;};
+    std::size_t spillCount() const {return m_spillCount;};
+
+    static constexpr std::size_t s_numPartitions{256};
+    static constexpr std::size_t s_blockSize{16 << 20};  // Input bytes partitioned at once
+
+private:
+    void partition(std::string_view text);
+
+    bool spill();
+
+    // Sorts one bucket and writes its stations. Returns false on write errors.
+    bool writePartition(std::size_t index, std::size_t& stationCount);
+
+    bool writeStation(std::string_view stationId, const std::string& text);
+
+    std::filesystem::path spillFilename(std::size_t index) const;
+
+    static std::size_t partitionOf(std::string_view stationId);
+
+    const std::filesystem::path m_outputDir;
+    const std::filesystem::path m_spillDir;
+    const std::size_t m_memoryBudget;
+
+    std::vector<std::string> m_partitions;  // Buffered rows per bucket, each terminated by a line break
+    std::size_t m_bufferedBytes{0};
+    std::size_t m_rowCount{0};
+    std::size_t m_stationCount{0};
+    std::size_t m_spillCount{0};
+    bool m_spillFailed{false};
+};
+
+#endif // BYYEARINGEST_HPP
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "measurement.hpp"
+#include "stationmeasurements.hpp"
+#include "yearseries.hpp"
+#include "datacompleteness.hpp"
+
+
+// Bit of the first day of each month in a leap year.
+static constexpr std::array<int, 12> s_monthOffsets{0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335};
+
+
+DataCompleteness::DataCompleteness(const StationMeasurements& measurements)
+{
+    for (std::size_t typeIndex = 0; typeIndex < StationMeasurements::s_numTypes; ++typeIndex) {
+        const auto type = static_cast<MeasurementType>(typeIndex);
+        const auto series = measurements.series(type);
+        if (series.empty()) {
+            continue;
+        }
+        const int firstYear = measurements.firstYear(type);
+        const int lastYear = measurements.lastYear(type);
+        const YearSeries entry{static_cast<std::uint32_t>(typeIndex), firstYear, static_cast<std::uint32_t>(lastYear - firstYear + 1),
+                           static_cast<std::uint32_t>(m_words.size())};
+        m_words.resize(m_words.size() + entry.yearCount * s_wordsPerYear, 0);
+        std::uint64_t* words = m_words.data() + entry.first;
+        for (const Measurement& m : series) {
+            const int month = std::clamp(m.getMonth(), 1, 12);
+            const int day = std::clamp(s_monthOffsets[month - 1] + m.getDay() - 1, 0, 365);
+            std::uint64_t* year = words + static_cast<std::size_t>(m.getYear() - firstYear) * s_wordsPerYear;
+            year[day / 64] |= std::uint64_t{1} << (day % 64);
+        }
+        m_series.push_back(entry);
+    }
+}
+
+
+int
+DataCompleteness::daysWithData(MeasurementType type, int year) const
+{
+    const YearSeries* series = YearSeries::find(m_series, type);
+    if (series == nullptr || year < series->firstYear || year > series->lastYear()) {
+        return 0;
+    }
+    const std::uint64_t* words = m_words.data() + series->first + static_cast<std::size_t>(year - series->firstYear) * s_wordsPerYear;
+    int days{0};
+    for (std::size_t i = 0; i < s_wordsPerYear; ++i) {
+        days += std::popcount(words[i]);
+    }
+    return days;
+}
+
+
+bool
+DataCompleteness::isComplete(MeasurementType type, int startYear, int endYear, double minFraction) const
+{
+    for (int year = startYear; year <= endYear; ++year) {
+        if (daysWithData(type, year) < std::ceil(minFraction * daysInYear(year))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+std::size_t
+DataCompleteness::memoryUsage() const
+{
+    return sizeof(DataCompleteness) + m_series.capacity() * sizeof(YearSeries) + m_words.capacity() * sizeof(std::uint64_t);
+}
+
+
+int
+DataCompleteness::daysInYear(int year)
+{
+    const bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return leap ? 366 : 365;
+}
+
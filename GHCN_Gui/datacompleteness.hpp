@@ -0,0 +1,52 @@
+#ifndef DATACOMPLETENESS_HPP
+#define DATACOMPLETENESS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "measurement.hpp"
+#include "stationmeasurements.hpp"
+#include "yearseries.hpp"
+
+/*
+    Days with data per year and element of a station, as bitmaps.
+
+    The inventory only knows the first and the last year of an element, gaps in between are
+    invisible there. Here every year of an element gets s_wordsPerYear 64 bit words, one bit per
+    day of a 366 day year (February 29 keeps its bit in other years, it is never set). Counting
+    the days of a year is a popcount per word, so a check like "90 % of the days in every year
+    from 1960 to 2023" needs no measurements.
+
+    Only elements with measurements get bitmaps, from their first to their last year. The
+    bitmaps are built with the binary sidecar and stored in it (see BinaryCache).
+*/
+class DataCompleteness
+{
+public:
+    DataCompleteness() = default;
+
+    explicit DataCompleteness(const StationMeasurements& measurements);
+
+    // Days of the year with a measurement of the type.
+    int daysWithData(MeasurementType type, int year) const;
+
+    // True if every year in [startYear, endYear] has measurements of the type on at least
+    // minFraction of its days (0.9: 329 of 365 days).
+    bool isComplete(MeasurementType type, int startYear, int endYear, double minFraction) const;
+
+    // Bytes allocated by this object, including unused vector capacity.
+    std::size_t memoryUsage() const;
+
+    static int daysInYear(int year);
+
+    static constexpr std::size_t s_wordsPerYear{6};  // 384 bits for up to 366 days
+
+private:
+    friend class BinaryCache;
+
+    std::vector<YearSeries> m_series;  // Ascending by type, first: bitmap of firstYear in m_words
+    std::vector<std::uint64_t> m_words;
+};
+
+#endif // DATACOMPLETENESS_HPP
@@ -16,13 +16,14 @@
 
 */
 
+#include <charconv>
+#include <chrono>
+#include <cstdint>
 #include <cmath>
 #include <iostream>
-#include <numeric>
 #include <ranges>
 #include <string>
 #include <format>
-#include <regex>
 #include <memory>
 #include <map>
 #include <algorithm>
@@ -31,9 +32,24 @@
 #include <span>
 #include <fstream>
 #include <filesystem>
+#include <functional>
+#include <future>
+#include <string_view>
+#include <utility>
 
 #include "measurement.hpp"
-#include "station.hpp"
+#include "stationkey.hpp"
+#include "stationmetadata.hpp"
+#include "metadatasnapshot.hpp"
+#include "spatialindex.hpp"
+#include "measurementparser.hpp"
+#include "measurementfilter.hpp"
+#include "mappedfile.hpp"
+#include "binarycache.hpp"
+#include "datacompleteness.hpp"
+#include "monthlyaggregates.hpp"
+#include "measurementscache.hpp"
+#include "gzipreader.hpp"
 
 #include "dataprovider.hpp"
 
@@ -41,17 +57,93 @@
 DataProvider::DataProvider(const std::string& dataDirName,
                            const std::string& stationFileName,
                            const std::string& inventoryFileName,
-                           const std::string& csvExt)
+                           const std::string& csvExt,
+                           std::function<void()> onReady)
     : m_dataDirName(dataDirName),
     m_stationFileName(stationFileName),
     m_inventoryFileName{inventoryFileName},
     m_csvExt(csvExt)
 {
-    m_StationsCache = std::make_unique<std::vector<Station>>();
-    readStations();  // Fill station cache. TODO: raise user-defined exception if reading fails.
+    // TODO: raise user-defined exception if reading fails.
+    m_ready = std::async(std::launch::async, [this, onReady = std::move(onReady)]() {
+        const std::string stationsFilename = std::format("{}{}", m_dataDirName, m_stationFileName);
+        const std::string inventoryFilename = std::format("{}{}", m_dataDirName, m_inventoryFileName);
+        const std::string snapshotFilename = MetadataSnapshot::snapshotFilenameFor(stationsFilename);
+        if (!MetadataSnapshot::read(snapshotFilename, stationsFilename, inventoryFilename, m_metadata)) {
+            // Stations and inventory do not depend on each other => parse them concurrently.
+            auto stations = std::async(std::launch::async, [this]() {
+                const bool stationsRead = readStations();
+                m_metadata.buildSpatialIndex();
+                return stationsRead;
+            });
+            const bool inventoryRead = readInventory();
+            const bool stationsRead = stations.get();
+            if (stationsRead && inventoryRead) {
+                // Failure (e. g. read-only directory) is not an error.
+                MetadataSnapshot::write(snapshotFilename, stationsFilename, inventoryFilename, m_metadata);
+            }
+        }
+        if (onReady) {
+            onReady();
+        }
+    });
+}
+
+
+DataProvider::~DataProvider()
+{
+    // The readers write into members.
+    waitUntilReady();
+}
+
+
+bool
+DataProvider::isReady() const
+{
+    return m_ready.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+
+void
+DataProvider::waitUntilReady() const
+{
+    m_ready.wait();
+}
 
-    m_stationInventory = std::make_unique<std::vector<InventoryEntry>>();
-    readInventory();
+
+// Calls func for every line of text, without the line break (and a carriage return before it).
+template<typename Func>
+static void
+forEachLine(std::string_view text, Func func)
+{
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+        std::size_t eol = text.find('\n', pos);
+        if (eol == std::string_view::npos) {
+            eol = text.size();  // Last line without line break
+        }
+        std::string_view line = text.substr(pos, eol - pos);
+        if (line.ends_with('\r')) {
+            line.remove_suffix(1);
+        }
+        func(line);
+        pos = eol + 1;
+    }
+}
+
+
+// Number in a fixed width column, padded with blanks. False if the column holds anything else.
+template<typename T>
+static bool
+parseColumn(std::string_view column, T& value)
+{
+    const std::size_t first = column.find_first_not_of(' ');
+    if (first == std::string_view::npos) {
+        return false;
+    }
+    column = column.substr(first, column.find_last_not_of(' ') - first + 1);
+    const auto [ptr, ec] = std::from_chars(column.data(), column.data() + column.size(), value);
+    return ec == std::errc() && ptr == column.data() + column.size();
 }
 
 
@@ -59,26 +151,41 @@ bool
 DataProvider::readInventory()
 {
     std::string filename = std::format("{}{}", m_dataDirName, m_inventoryFileName);
-    // std::cout << filename << std::endl;
-    if (std::ifstream inStream{filename, std::ios::in}) {
-        std::string line;
-        while (std::getline(inStream, line)) {
-            try {
-                const std::string id = line.substr(0, 11);
-                const std::string typeName = line.substr(31, 4);
-                const MeasurementType type = Measurement::s_mapStringMeasurementType.at(typeName);
-                const int startYear = stoi(line.substr(36, 4));
-                const int endYear = stoi(line.substr(41,4));
-                // std::cout << ">" << id << "<" << ">" << typeName << "<" << ">" << startYear << "<" << ">" << endYear << "<";
-                m_stationInventory->push_back(InventoryEntry(id, type, startYear, endYear));
-            } catch(std::out_of_range) {
-                // Unknown measurement type (i. e. not in map) => continue.
-            }
-        }
-        return true;
+    // Single bulk read (mapping if possible), fields are taken from their fixed columns in place.
+    std::string buffer;
+    MappedFile mappedFile(filename);
+    std::string_view text;
+    if (mappedFile.isValid()) {
+        mappedFile.adviseSequential();
+        text = mappedFile.view();
+    } else if (readTextFile(filename, buffer)) {
+        text = buffer;
     } else {
         return false;  // File stream not valid
     }
+    std::vector<std::pair<StationKey, StationMetadata::InventoryEntry>> rows;
+    rows.reserve(text.size() / 46);  // 45 characters and line break
+    forEachLine(text, [&rows](std::string_view line) {
+        if (line.size() < 45) {
+            return;  // Incomplete line
+        }
+        const MeasurementType type = Measurement::typeFromString(line.substr(31, 4));
+        if (type == MeasurementType::UNKNOWN) {
+            return;  // Element not in registry
+        }
+        std::int16_t startYear{0};
+        std::int16_t endYear{0};
+        if (!parseColumn(line.substr(36, 4), startYear) || !parseColumn(line.substr(41, 4), endYear)) {
+            return;
+        }
+        const StationKey key(line.substr(0, 11));
+        if (!key.isValid()) {
+            return;
+        }
+        rows.emplace_back(key, StationMetadata::InventoryEntry{startYear, endYear, type});
+    });
+    m_metadata.setInventory(std::move(rows));
+    return true;
 }
 
 
@@ -86,41 +193,64 @@ bool
 DataProvider::readStations()
 {
     std::string filename = std::format("{}{}", m_dataDirName, m_stationFileName);
-    if (std::ifstream inStream{filename, std::ios::in}) {
-        std::string line;
-        while (std::getline(inStream, line)) {
-            std::string id = line.substr(0, 11);
-            double latitude = std::stod(line.substr(12, 8));
-            double longitude = std::stod(line.substr(21, 9));
-            double elevation = std::stod(line.substr(31, 6));
-            std::string name = line.substr(41, 30);
-            // Remove trailing whitespace
-            size_t endpos = name.find_last_not_of(" \t\n\r");
-            if (std::string::npos != endpos)
-                name.erase(endpos + 1);
-            m_StationsCache->push_back(Station(id, latitude, longitude, elevation, name));
-        }
-        return true;
+    // Same approach as readInventory().
+    std::string buffer;
+    MappedFile mappedFile(filename);
+    std::string_view text;
+    if (mappedFile.isValid()) {
+        mappedFile.adviseSequential();
+        text = mappedFile.view();
+    } else if (readTextFile(filename, buffer)) {
+        text = buffer;
     } else {
         return false;  // File stream not valid
     }
+    m_metadata.reserveStations(text.size() / 86);  // 85 characters and line break
+    forEachLine(text, [this](std::string_view line) {
+        double latitude{0};
+        double longitude{0};
+        double elevation{0};
+        if (line.size() < 37 ||
+            !parseColumn(line.substr(12, 8), latitude) ||
+            !parseColumn(line.substr(21, 9), longitude) ||
+            !parseColumn(line.substr(31, 6), elevation)) {
+            return;  // Incomplete line
+        }
+        const StationKey key(line.substr(0, 11));
+        if (!key.isValid()) {
+            return;
+        }
+        std::string_view name = line.size() > 41 ? line.substr(41, 30) : std::string_view();
+        // Remove trailing whitespace
+        const std::size_t endpos = name.find_last_not_of(" \t");
+        name = endpos == std::string_view::npos ? std::string_view() : name.substr(0, endpos + 1);
+        m_metadata.addStation(key, latitude, longitude, elevation, name);
+    });
+    return true;
 }
 
 
 double
 DataProvider::haversine(double lat1,  double lat2, double lng1, double lng2)
 {
-    constexpr double earth_radius = 6378.388;
-
     const double r_lat1 = lat1 * std::numbers::pi_v<double> / 180;
     const double r_lng1 = lng1 * std::numbers::pi_v<double> / 180;
     const double r_lat2 = lat2 * std::numbers::pi_v<double> / 180;
     const double r_lng2 = lng2 * std::numbers::pi_v<double> / 180;
 
+    return haversineRadians(r_lat1, r_lat2, r_lng1, r_lng2, cos(r_lat1), cos(r_lat2));
+}
+
+
+double
+DataProvider::haversineRadians(double r_lat1, double r_lat2, double r_lng1, double r_lng2, double cos_lat1, double cos_lat2)
+{
+    constexpr double earth_radius = SpatialIndex::s_earthRadius;
+
     const double d_lat = r_lat2 - r_lat1;
     const double d_lng = r_lng2 - r_lng1;
 
-    double a = pow(sin(d_lat / 2), 2) + pow(sin(d_lng / 2), 2) * cos(r_lat1) * cos(r_lat2);
+    double a = pow(sin(d_lat / 2), 2) + pow(sin(d_lng / 2), 2) * cos_lat1 * cos_lat2;
     if (a > 1) {
         a = 1;
     }
@@ -131,19 +261,30 @@ DataProvider::haversine(double lat1,  double lat2, double lng1, double lng2)
     return dist;
 }
 
+
 std::unique_ptr<std::vector<std::pair<int, double>>>
-DataProvider::calcNearestStations(double latitude, double longitude, int radius)
+DataProvider::calcNearestStations(double latitude, double longitude, int radius, std::size_t top,
+                                  const std::function<bool(std::uint32_t)>& accept)
 {
     auto nearestStations = std::make_unique<std::vector<std::pair<int, double>>>();
-    // 1. Calculate distance from given lat and lng for all stations
-    for (int index{0}; const Station& station : *m_StationsCache) {
-        double distance = haversine(latitude, station.getLatitude(), longitude, station.getLongitude());
+    const double r_latitude = latitude * std::numbers::pi_v<double> / 180;
+    const double r_longitude = longitude * std::numbers::pi_v<double> / 180;
+    const double cos_latitude = cos(r_latitude);
+    // 1. Calculate distance from given lat and lng for the stations the spatial index finds near it
+    const SpatialIndex& spatialIndex = m_metadata.spatialIndex();
+    const std::vector<std::uint32_t> candidates = top > 0 ? spatialIndex.nearest(latitude, longitude, top, radius, accept)
+                                                          : spatialIndex.withinRadius(latitude, longitude, radius);
+    for (std::uint32_t index : candidates) {
+        if (top == 0 && accept && !accept(index)) {
+            continue;
+        }
+        double distance = haversineRadians(r_latitude, m_metadata.latitudeRadians(index), r_longitude, m_metadata.longitudeRadians(index),
+                                           cos_latitude, m_metadata.cosLatitude(index));
         if (distance <= radius) {
-            nearestStations->push_back(std::pair<int, double>(index, distance));
+            nearestStations->push_back(std::pair<int, double>(static_cast<int>(index), distance));
         }
-        ++index;
     }
-    // 2. Sort ascending by distance
+    // 2. Sort ascending by distance (at most top entries if limited)
     std::ranges::sort(*nearestStations, [](auto p1, auto p2) {return p1.second < p2.second;});
 
     // 3. Give back sorted stations
@@ -152,101 +293,141 @@ DataProvider::calcNearestStations(double latitude, double longitude, int radius)
 
 
 bool
-DataProvider::readMeasurementsForStation(const std::string& stationId)
+DataProvider::preloadMeasurements(const std::string& stationId, const MeasurementFilter& filter)
 {
-    if (m_MeasurementsCache.contains(stationId)) {
+    return readMeasurementsForStation(StationKey(stationId), filter);
+}
+
+
+bool
+DataProvider::readMeasurementsForStation(StationKey key, const MeasurementFilter& filter)
+{
+    if (!key.isValid()) {
+        return false;  // Not a station ID
+    }
+    if (m_MeasurementsCache.lookup(key, filter) != nullptr) {
         return true;
     }
-    std::string filename = csvFilenameFromStationId(stationId);
+    // Load the union of what is cached and what is asked for, so a top-up never loses earlier data.
+    MeasurementFilter coverage = filter;
+    if (const MeasurementFilter* cached = m_MeasurementsCache.coverage(key)) {
+        coverage.add(*cached);
+    }
+    std::string filename = csvFilenameFromStationId(key);
     if (filename.empty()) {
         return false;
     }
+    const MeasurementFilter* rowFilter = coverage.acceptsAll() ? nullptr : &coverage;
+
+    // Fast path: binary sidecar written after an earlier parse of the same (unchanged) file. Only the
+    // selection is copied out of it.
+    const std::string cacheFilename = BinaryCache::cacheFilenameFor(filename);
+    if (auto stationMeasurements = std::make_unique<StationMeasurements>();
+        BinaryCache::read(cacheFilename, filename, *stationMeasurements, rowFilter)) {
+        bool found = !stationMeasurements->empty();
+        m_MeasurementsCache.insert(key, std::move(stationMeasurements), coverage);
+        return found;
+    }
 
-    // Note: ifstream is automatically closed when it goes out of scope.
-    // See: https://en.cppreference.com/w/cpp/io/basic_ifstream/close
+    // No valid sidecar: parse the whole file once and write the sidecar with it, so every later load
+    // of the station, also after a restart, takes the fast path. The parse keeps all measurements.
+    auto measurements = std::make_unique<std::vector<Measurement>>();
 
-    if (std::ifstream inStream{filename, std::ios::in}) {
-        m_MeasurementsCache.try_emplace(stationId, std::make_unique<std::vector<Measurement>>());  // Inserts in-place
-        // Get a reference. We do *not* want a copy.
-        std::unique_ptr<std::vector<Measurement>>& measurements = m_MeasurementsCache[stationId];
-        std::string line;
-        std::smatch match;
-        // Matches at least one subexpression "everything but comma" to the left.
-        std::regex item{"[^,]+"};
-        while (std::getline(inStream, line)) {
-            // Station ID (skipped)
-            std::regex_search(line, match, item);
-            line = match.suffix();  // Rest of string not yet searched.
-            // Date
-            std::regex_search(line, match, item);
-            std::string date{match.str()};
-            line = match.suffix();
-            // Element
-            std::regex_search(line, match, item);
-            std::string element{match.str()};
-            line = match.suffix();
-            // Value
-            std::regex_search(line, match, item);
-            int value = stoi(match.str());
-            measurements->push_back(Measurement(date, value, element));
+    const MeasurementParser::Format format = MeasurementParser::formatForFilename(filename);
+    if (GzipReader::isGzipFilename(filename)) {
+        // Compressed mirror: inflate and parse in one streaming pass.
+        if (!MeasurementParser::parseGzip(filename, *measurements, format)) {
+            return false;  // Not readable or corrupt. Do not cache a partial parse.
         }
-        if (measurements->empty()) {
-            return false;  // No measurements found
+    } else {
+        // Preferred: parse straight out of the mapped pages. The file is unmapped at the end of this scope.
+        MappedFile mappedFile(filename);
+        if (mappedFile.isValid()) {
+            mappedFile.adviseSequential();
+            const std::string_view text = mappedFile.view();
+            MeasurementParser::parseParallel(text, *measurements, MeasurementParser::chunkCountForSize(text.size()), format);
         } else {
-            return true;
+            // Fallback for files that cannot be mapped.
+            std::string text;
+            if (!readTextFile(filename, text)) {
+                return false;  // File stream not valid.
+            }
+            MeasurementParser::parseParallel(text, *measurements, MeasurementParser::chunkCountForSize(text.size()), format);
         }
-    } else {
-        // File stream not valid.
-        return false;
     }
+    // Partitioned copy goes into the cache, the parse buffer is released at the end of this function.
+    auto stationMeasurements = std::make_unique<StationMeasurements>(*measurements);
+    bool found = !stationMeasurements->empty();
+    if (found) {
+        // Failure (e. g. read-only directory) is not an error, the next session parses again.
+        BinaryCache::write(cacheFilename, filename, *stationMeasurements);
+    }
+    m_MeasurementsCache.insert(key, std::move(stationMeasurements), MeasurementFilter::all());
+    return found;  // false: no measurements found
 }
 
 
-std::span<const Measurement>
-DataProvider::calcMeasurementSpanForYearRange(const std::unique_ptr<std::vector<Measurement>>& measurements, int startYear, int endYear)
+bool
+DataProvider::readTextFile(const std::string& filename, std::string& text)
 {
-    const std::vector<Measurement>& data = *measurements;
-    
-    // Determines iterator to start year.
-    auto startIter = std::ranges::find_if(data, [startYear](auto m) {return m.getYear() == startYear;});
-    if (startIter == data.end()) {
-        // Start year not found => return empty span.
-        return std::span<Measurement>();
-    }
+    // Note: ifstream is automatically closed when it goes out of scope.
+    // See: https://en.cppreference.com/w/cpp/io/basic_ifstream/close
 
-    // Determines iterator to end year. Reverse search from end.
-    auto it = std::ranges::find_if(data | std::ranges::views::reverse, [endYear](auto m) {return m.getYear() == endYear;});
-    auto endIter = data.end(); // Initialize with reasonable value
-    if (it != data.rend()) { 
-        endIter = std::next(it).base();  // Get forward iterator to end of span.
-    }
-    
-    if (startIter != data.end() && endIter != data.end()) {
-        return std::span(startIter, endIter);
-    }
-    else {
-        // End year not found => return empty span.
-        return std::span<Measurement>();
+    if (std::ifstream inStream{filename, std::ios::in | std::ios::binary}) {
+        // Read the whole file with a single bulk read. The scanner then works on this buffer without copying lines.
+        inStream.seekg(0, std::ios::end);
+        const std::streamoff size = inStream.tellg();
+        if (size < 0) {
+            return false;  // Not seekable
+        }
+        text.resize(static_cast<std::size_t>(size));
+        inStream.seekg(0, std::ios::beg);
+        inStream.read(text.data(), static_cast<std::streamsize>(text.size()));
+        text.resize(static_cast<std::size_t>(inStream.gcount()));
+        return true;
+    } else {
+        return false;
     }
 }
 
 
+float
+DataProvider::average(const MonthlyAggregates::Total& total, float scaling)
+{
+    // Sum of measurement values to average. Scaling before division to prevent rounding errors.
+    return total.sum * scaling / static_cast<std::size_t>(total.count);
+}
+
+
 const std::string
-DataProvider::csvFilenameFromStationId(const std::string& station_id)
+DataProvider::csvFilenameFromStationId(StationKey key)
 {
+    const std::string station_id = key.toString();
     // Check if data directory exists.
     if (!std::filesystem::exists(m_dataDirName)) {
         std::cerr << std::format("Directory {} does not exist\n", m_dataDirName);
         return std::string("");
     }
     const std::filesystem::path data_dir{m_dataDirName};
-    std::vector<std::string> fileNames;
+    // Accepted forms in order of preference: plain files are mapped, compressed ones have to be inflated.
+    std::vector<std::string> extensions{m_csvExt, std::string(MeasurementParser::s_dlyExtension)};
+    if (GzipReader::isAvailable()) {
+        extensions.push_back(m_csvExt + std::string(GzipReader::s_extension));
+        extensions.push_back(std::string(MeasurementParser::s_dlyExtension) + std::string(GzipReader::s_extension));
+    }
+    // Stem and index into extensions.
+    std::vector<std::pair<std::string, std::size_t>> fileNames;
     for (auto const& entry : std::filesystem::directory_iterator{data_dir}) {
         if (!entry.is_directory()) {
-            const std::string stem = entry.path().filename().stem().string();
-            const std::string ext = entry.path().filename().extension().string();
-            if (ext == m_csvExt && stem.starts_with(station_id)) {
-                fileNames.push_back(stem);
+            const std::string name = entry.path().filename().string();
+            if (!name.starts_with(station_id)) {
+                continue;
+            }
+            for (std::size_t i = 0; i < extensions.size(); ++i) {
+                if (name.ends_with(extensions[i])) {
+                    fileNames.emplace_back(name.substr(0, name.size() - extensions[i].size()), i);
+                    break;
+                }
             }
         }
     }
@@ -255,7 +436,9 @@ DataProvider::csvFilenameFromStationId(const std::string& station_id)
         return std::string("");
     }
     std::sort(fileNames.begin(), fileNames.end());
-    std::string filename = data_dir.string() + fileNames.back() + m_csvExt;
+    // Latest file. If it exists in several forms, the preferred one.
+    auto latest = std::ranges::find(fileNames, fileNames.back().first, &std::pair<std::string, std::size_t>::first);
+    std::string filename = data_dir.string() + latest->first + extensions[latest->second];
     return filename;
 }
 
@@ -266,29 +449,20 @@ DataProvider::getYearlyAverages(const std::string& stationId, int startYear, int
     // map keeps entries in ascending order based on key (which is the year here).
     auto yearlyAverages = std::make_unique<std::map<int, float>>();
 
-    if (!readMeasurementsForStation(stationId)) {
+    const MonthlyAggregates* aggregates = aggregatesForStation(StationKey(stationId), MeasurementFilter({type}, startYear, endYear));
+    if (aggregates == nullptr) {
         return yearlyAverages;  // => empty map
     }
-    const std::unique_ptr<std::vector<Measurement>>& measurements = m_MeasurementsCache[stationId];
-
-    auto interval = calcMeasurementSpanForYearRange(measurements, startYear, endYear);
-    if (interval.empty()) {
-        return yearlyAverages;  // => empty map
-    }
-    auto filtered_interval{interval | std::views::filter([type](auto m) {return m.getType() == type;})};
     float scaling = Measurement::getScalingForType(type);
 
-    auto it = filtered_interval.begin();
-    while (it != filtered_interval.end()) {
-        int year{it->getYear()};
-        // Points after last measurement for current year.
-        auto last = std::find_if(it, filtered_interval.end(), [year](const auto& m){return m.getYear() != year;});
-        // Adds up measurement values and calculates average. Scaling before division to prevent rounding errors.
-        float average = std::accumulate(it, last, 0, [](int sum, Measurement m){return sum + m.getValue();}) * scaling /
-                        (std::ranges::distance(it, last));  // distance can not be zero, as year exists.
-        //std::cout << std::format("{} values in {}\n", std::ranges::distance(it, last), year);
-        (*yearlyAverages)[year] = average; // O(1) for unordered_map, O(log n) for ordered map.
-        it = last;
+    // Only years with data for the type.
+    const int firstYear = std::max(startYear, aggregates->firstYear(type));
+    const int lastYear = std::min(endYear, aggregates->lastYear(type));
+    for (int year = firstYear; year <= lastYear; ++year) {
+        const MonthlyAggregates::Total total = aggregates->total(type, year, 1, year, 12);
+        if (!total.empty()) {
+            (*yearlyAverages)[year] = average(total, scaling); // O(1) for unordered_map, O(log n) for ordered map.
+        }
     }
     return yearlyAverages;
 }
@@ -300,71 +474,37 @@ DataProvider::getAveragesForMonthRange(const std::string& stationId, int startYe
     // map keeps entries in ascending order based on key (which is the year here).
     auto yearlyAverages = std::make_unique<std::map<int, float>>();
 
-    if (!readMeasurementsForStation(stationId)) {
-        return yearlyAverages;  // no data at all => empty map
-    }
-    const std::unique_ptr<std::vector<Measurement>>& measurements = m_MeasurementsCache[stationId];
+    // Continuation over year boundary (e. g. meteorological winter in northern hemisphere):
+    // The range starts in the year before the one it is assigned to.
+    const int yearShift = startMonth > endMonth ? 1 : 0;
 
-    auto interval = calcMeasurementSpanForYearRange(measurements, (startMonth <= endMonth ? startYear : startYear - 1), endYear);
-    if (interval.empty()) {
-        return yearlyAverages;  // no data for required range => empty map
+    const MonthlyAggregates* aggregates = aggregatesForStation(StationKey(stationId),
+                                                               MeasurementFilter({type}, startYear - yearShift, endYear));
+    if (aggregates == nullptr) {
+        return yearlyAverages;  // no data at all => empty map
     }
-    auto filtered_interval{interval | std::views::filter([type](auto m) {return m.getType() == type;})};
     float scaling = Measurement::getScalingForType(type);
 
-    auto it = filtered_interval.begin();
-    while (it != filtered_interval.end()) {
-        int year{it->getYear()};
-        // Points to first measurement for start month in current year.
-        auto first = std::find_if(it, filtered_interval.end(),
-                                  [year, startMonth](const auto& m)
-                                  {return m.getYear() == year && m.getMonth() == startMonth;});
-
-        if (first == filtered_interval.end()) {
-            // Required start month not found => advance to next available year.
-            it = std::find_if(it, filtered_interval.end(), [year](const auto& m){return m.getYear() != year;});
+    // Only years with data for the type.
+    const int firstYear = std::max(startYear - yearShift, aggregates->firstYear(type));
+    const int lastYear = std::min(endYear, aggregates->lastYear(type));
+
+    for (int year = firstYear; year + yearShift <= lastYear; ++year) {
+        // Required start month not found => next year.
+        if (aggregates->total(type, year, startMonth, year, startMonth).empty()) {
             continue;
         }
-        auto tmp = first;
-        if (startMonth > endMonth) {
-            // Continuation over year boudary => advance to *directly following* year.
-            tmp = std::find_if(first, filtered_interval.end(), [year](const auto& m){return m.getYear() != year;});
-
-            // Not found => advance to *next available* year.
-            if (tmp == filtered_interval.end() || tmp->getYear() != year + 1) {
-                it = std::find_if(it, filtered_interval.end(), [year](const auto& m){return m.getYear() != year;});
-                continue;
-            }
-            ++year;
+        // Continuation over year boundary requires data in the directly following year.
+        if (yearShift > 0 && aggregates->total(type, year + 1, 1, year + 1, 12).empty()) {
+            continue;
         }
-        // Points after last measurement for end month in current or following year.
-        auto last = std::find_if(tmp, filtered_interval.end(),
-                                 [year, endMonth](const auto& m)
-                                 {return m.getYear() != year || m.getMonth() > endMonth;});
+        const MonthlyAggregates::Total total = aggregates->total(type, year, startMonth, year + yearShift, endMonth);
 
-        // Special case: Last measurement satisfies conditions. TODO: Can this be solved by a reverse iterator?
-        bool lastElementMatches = filtered_interval.back().getYear() == year && filtered_interval.back().getMonth() == endMonth;
-
-        // Required end month not found => advance to next available year.
-        if (last == filtered_interval.end() && !(lastElementMatches)) {
-            it = std::find_if(it, filtered_interval.end(), [year](const auto& m){return m.getYear() != year;});
+        // Range not completed yet (no data for the end month or later up to endYear) => skip.
+        if (aggregates->total(type, year + yearShift, endMonth, lastYear, 12).empty()) {
             continue;
         }
-        // Adds up measurement values and calculates average. Scaling before division to prevent rounding errors.
-        auto numElements = std::ranges::distance(first, last);
-        if (numElements > 0) {
-            float average = std::accumulate(first, last, 0,
-                                            [](int sum, Measurement m){return sum + m.getValue();}) * scaling / numElements;
-            // if (startMonth > endMonth) {
-            //     std::cout << std::format("{:04d}-{:02d}-{:02d} to ", first->getYear(), first->getMonth(), first->getDay());
-            //     std::cout << std::format("{:04d}-{:02d}-{:02d}: {:.4f}\n", last->getYear(), last->getMonth(), last->getDay(), average);
-            // }
-            (*yearlyAverages)[year] = average; // O(1) for unordered_map, O(log n) for ordered map.
-        }
-        // Advance iterator to next available year.
-        // Compare with previous year in case of continuation over year boundary (e. g. meterological winter in nothern hemisphere.
-        year = first->getYear();
-        it = std::find_if(last, filtered_interval.end(), [year](const auto& m){return m.getYear() != year;});
+        (*yearlyAverages)[year + yearShift] = average(total, scaling); // O(1) for unordered_map, O(log n) for ordered map.
     }
     return yearlyAverages;
 }
@@ -373,34 +513,21 @@ DataProvider::getAveragesForMonthRange(const std::string& stationId, int startYe
 std::unique_ptr<std::map<int, float>>
 DataProvider::getMonthlyAverages(const std::string& stationId, int year, const MeasurementType& type)
 {
-    // map keeps entries in ascending order based on key (which is the year here).
+    // map keeps entries in ascending order based on key (which is the month here).
     auto monthlyAverages = std::make_unique<std::map<int, float>>();
 
-    if (!readMeasurementsForStation(stationId)) {
+    const MonthlyAggregates* aggregates = aggregatesForStation(StationKey(stationId), MeasurementFilter({type}, year, year));
+    if (aggregates == nullptr) {
         return monthlyAverages;  // => empty map
     }
-    const std::unique_ptr<std::vector<Measurement>>& measurements = m_MeasurementsCache[stationId];
-
-    auto interval = calcMeasurementSpanForYearRange(measurements, year, year);
-    auto filtered_interval{interval | std::views::filter([type](auto m) {return m.getType() == type;})};
     float scaling = Measurement::getScalingForType(type);
 
-    // Start: Iterator to year.
-    auto it = std::ranges::find_if(filtered_interval, [year](auto m) {return m.getYear() == year;});
-    if (it == filtered_interval.end()) {
-        // Year not found => return empty map.
-        return monthlyAverages;
-    }
-    auto last = std::find_if(it, filtered_interval.end(), [year](const auto& m){return m.getYear() != year;});
-    // Add up measurements for each month in year.
-    while (it != last) {
-        int month{it->getMonth()};
-        auto last_day = std::find_if(it, filtered_interval.end(), [month](const auto& m){return m.getMonth() != month;});
-        float average = std::accumulate(it, last_day, 0, [](int sum, Measurement m){return sum + m.getValue();}) * scaling /
-                        (std::ranges::distance(it, last_day));  // distance can not be zero, as month exists.
-        //std::cout << std::format("{} values in {}\n", std::ranges::distance(it, last_day), month);
-        (*monthlyAverages)[month] = average;
-        it = last_day;
+    // Sums and counts of each month in year.
+    for (int month = 1; month <= 12; ++month) {
+        const MonthlyAggregates::Total total = aggregates->total(type, year, month, year, month);
+        if (!total.empty()) {
+            (*monthlyAverages)[month] = average(total, scaling);
+        }
     }
     return monthlyAverages;
 }
@@ -409,50 +536,49 @@ DataProvider::getMonthlyAverages(const std::string& stationId, int year, const M
 std::unique_ptr<std::map<int, float>>
 DataProvider::getDailyValues(const std::string& stationId, int year, int month, const MeasurementType& type)
 {
-    // map keeps entries in ascending order based on key (which is the year here).
+    // map keeps entries in ascending order based on key (which is the day here).
     auto dailyValues = std::make_unique<std::map<int, float>>();
 
-    if (!readMeasurementsForStation(stationId)) {
+    const StationKey key(stationId);
+    if (!readMeasurementsForStation(key, MeasurementFilter({type}, year, year))) {
         return dailyValues;  // => empty map
     }
-    const std::unique_ptr<std::vector<Measurement>>& measurements = m_MeasurementsCache[stationId];
-
-    auto interval = calcMeasurementSpanForYearRange(measurements, year, year);
-    auto filtered_interval{interval | std::views::filter([type](auto m) {return m.getType() == type;})};
+    const StationMeasurements& measurements = m_MeasurementsCache.at(key);
     float scaling = Measurement::getScalingForType(type);
 
-    // Determines iterator to year.
-    auto it = std::ranges::find_if(filtered_interval, [year](auto m) {return m.getYear() == year;});
-    if (it == filtered_interval.end()) {
-        // year not found => return empty map.
-        return dailyValues;
-    }
-    // Advances iterator to month.
-    while (it != filtered_interval.end() && it->getMonth() != month) {
-        ++it;
-    }
-    if (it == filtered_interval.end()) {
-        // month not found => return empty map.
-        return dailyValues;
-    }
-    while (it != filtered_interval.end() && it->getMonth() == month) {
-        (*dailyValues)[it->getDay()] = it->getValue() * scaling;
-        ++it;
+    for (const Measurement& m : measurements.range(type, year, month, year, month)) {
+        (*dailyValues)[m.getDay()] = m.getValue() * scaling;
     }
     return dailyValues;
 }
 
 
 std::unique_ptr<std::vector<std::pair<std::string, double>>>
-DataProvider::getNearestStations(double latitude, double longitude, int radius)
+DataProvider::getNearestStations(double latitude, double longitude, int radius, std::size_t top)
 {
-    std::string filename = std::format("{}{}", m_dataDirName, m_stationFileName);
+    waitUntilReady();
+    auto nearest = calcNearestStations(latitude, longitude, radius, top);
     auto nearestStations = std::make_unique<std::vector<std::pair<std::string, double>>>();
-    if (std::ifstream inStream{filename, std::ios::in}) {
-        auto nearest = calcNearestStations(latitude, longitude, radius);
-        for (std::pair<int, double> p : *nearest) {
-            nearestStations->push_back(std::pair<std::string, double>(m_StationsCache->at(p.first).getId(), p.second));
-        }
+    for (std::pair<int, double> p : *nearest) {
+        nearestStations->push_back(std::pair<std::string, double>(m_metadata.key(p.first).toString(), p.second));
+    }
+    return nearestStations;
+}
+
+
+std::unique_ptr<std::vector<std::pair<std::string, double>>>
+DataProvider::getNearestStations(double latitude, double longitude, int radius, std::size_t top,
+                                 int startYear, int endYear, const std::vector<MeasurementType>& requiredTypes)
+{
+    waitUntilReady();
+    auto accept = [&](std::uint32_t index) {
+        const StationKey key = m_metadata.key(index);
+        return std::ranges::all_of(requiredTypes, [&](MeasurementType type) {return m_metadata.covers(key, type, startYear, endYear);});
+    };
+    auto nearest = calcNearestStations(latitude, longitude, radius, top, accept);
+    auto nearestStations = std::make_unique<std::vector<std::pair<std::string, double>>>();
+    for (std::pair<int, double> p : *nearest) {
+        nearestStations->push_back(std::pair<std::string, double>(m_metadata.key(p.first).toString(), p.second));
     }
     return nearestStations;
 }
@@ -461,11 +587,60 @@ DataProvider::getNearestStations(double latitude, double longitude, int radius)
 bool
 DataProvider::hasMeasurementsForYearRange(const std::string& stationId, int startYear, int endYear, MeasurementType type)
 {
-    const std::vector<InventoryEntry>& entries = *m_stationInventory;
+    waitUntilReady();
+    return m_metadata.covers(StationKey(stationId), type, startYear, endYear);
+}
 
-    auto iter = std::ranges::find_if(entries, [=](const InventoryEntry& entry) {return entry.stationId() == stationId &&
-                                                                                        entry.startYear() <= startYear &&
-                                                                                        entry.endYear() >= endYear &&
-                                                                                        entry.type() == type;});
-    return iter != entries.end();
+
+const MonthlyAggregates*
+DataProvider::aggregatesForStation(StationKey key, const MeasurementFilter& filter)
+{
+    if (!key.isValid()) {
+        return nullptr;  // Not a station ID
+    }
+    if (const MonthlyAggregates* cached = m_MeasurementsCache.aggregates(key, filter)) {
+        return cached;
+    }
+    const std::string filename = csvFilenameFromStationId(key);
+    if (filename.empty()) {
+        return nullptr;
+    }
+    if (auto aggregates = std::make_unique<MonthlyAggregates>();
+        BinaryCache::readAggregates(BinaryCache::cacheFilenameFor(filename), filename, *aggregates)) {
+        return &m_MeasurementsCache.insertAggregates(key, std::move(aggregates), true);
+    }
+    // No valid sidecar: the load parses the whole file and writes the sidecar, aggregates included, so the
+    // next session reads them from it. Already cached measurements of the selection are totalled as they are.
+    if (!readMeasurementsForStation(key, filter)) {
+        return nullptr;
+    }
+    const bool complete = m_MeasurementsCache.coverage(key)->acceptsAll();
+    return &m_MeasurementsCache.insertAggregates(key, std::make_unique<MonthlyAggregates>(m_MeasurementsCache.at(key)), complete);
+}
+
+
+bool
+DataProvider::hasCompleteMeasurements(const std::string& stationId, int startYear, int endYear, MeasurementType type, double minFraction)
+{
+    const StationKey key(stationId);
+    if (!key.isValid()) {
+        return false;  // Not a station ID
+    }
+    const DataCompleteness* cached = m_MeasurementsCache.completeness(key);
+    if (cached == nullptr) {
+        const std::string filename = csvFilenameFromStationId(key);
+        if (filename.empty()) {
+            return false;
+        }
+        auto completeness = std::make_unique<DataCompleteness>();
+        if (!BinaryCache::readCompleteness(BinaryCache::cacheFilenameFor(filename), filename, *completeness)) {
+            // No valid sidecar: a complete load writes one.
+            if (!readMeasurementsForStation(key, MeasurementFilter::all())) {
+                return false;
+            }
+            completeness = std::make_unique<DataCompleteness>(m_MeasurementsCache.at(key));
+        }
+        cached = &m_MeasurementsCache.insertCompleteness(key, std::move(completeness));
+    }
+    return cached->isComplete(type, startYear, endYear, minFraction);
 }
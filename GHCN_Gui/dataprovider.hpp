@@ -1,6 +1,8 @@
 #ifndef DATAPROVIDER_HPP
 #define DATAPROVIDER_HPP
 
+#include <functional>
+#include <future>
 #include <string>
 #include <memory>
 #include <vector>
@@ -9,7 +11,13 @@
 #include <utility>
 
 #include "measurement.hpp"
-#include "station.hpp"
+#include "stationkey.hpp"
+#include "stationmetadata.hpp"
+#include "stationmeasurements.hpp"
+#include "measurementfilter.hpp"
+#include "datacompleteness.hpp"
+#include "monthlyaggregates.hpp"
+#include "measurementscache.hpp"
 
 /*
 IV. FORMAT OF "ghcnd-stations.txt"
@@ -66,7 +74,22 @@ class DataProvider
 {
 public:
 
-    DataProvider(const std::string& dataDirName, const std::string& stationFileName, const std::string& inventoryFileName, const std::string& csvExt);
+    // Stations and inventory are read on worker threads, the constructor returns at once. onReady is called
+    // on a worker thread when both are available. Measurement queries do not depend on them and work meanwhile,
+    // station searches and inventory checks wait.
+    DataProvider(const std::string& dataDirName, const std::string& stationFileName, const std::string& inventoryFileName, const std::string& csvExt,
+                 std::function<void()> onReady = {});
+
+    // Waits for the worker threads.
+    ~DataProvider();
+
+    DataProvider(const DataProvider&) = delete;
+    DataProvider& operator=(const DataProvider&) = delete;
+
+    // True when stations and inventory are available. Does not block.
+    bool isReady() const;
+
+    void waitUntilReady() const;
 
     std::unique_ptr<std::map<int, float>>
     getYearlyAverages(const std::string& stationId, int startYear, int endYear, const MeasurementType& type);
@@ -80,31 +103,36 @@ public:
     std::unique_ptr<std::map<int, float>>
     getDailyValues(const std::string& stationId, int year, int month, const MeasurementType& type);
 
+    // Stations within radius (km), nearest first. With top > 0 only the top nearest ones: the spatial
+    // index stops early and only those are sorted.
     std::unique_ptr<std::vector<std::pair<std::string, double>>>
-    getNearestStations(double latitude, double longitude, int radius);
+    getNearestStations(double latitude, double longitude, int radius, std::size_t top = 0);
+
+    // Same, counting only stations whose inventory covers [startYear, endYear] for every required type.
+    // Coverage is checked during the search, for candidates that would make it into the top.
+    std::unique_ptr<std::vector<std::pair<std::string, double>>>
+    getNearestStations(double latitude, double longitude, int radius, std::size_t top,
+                       int startYear, int endYear, const std::vector<MeasurementType>& requiredTypes);
 
     bool
     hasMeasurementsForYearRange(const std::string& stationId, int startYear, int endYear, MeasurementType type);
 
-private:
-    class InventoryEntry
-    {
-    public:
-        InventoryEntry(const std::string& stationId, MeasurementType type, int startYear, int endYear)
-            : m_stationId(stationId), m_type(type), m_startYear(startYear), m_endYear(endYear)
-            {};
-
-        const std::string& stationId() const {return m_stationId;};
-        MeasurementType type() const {return m_type;};
-        int startYear() const {return m_startYear;};
-        int endYear() const {return m_endYear;};
-
-    private:
-        std::string m_stationId;
-        MeasurementType m_type;
-        int m_startYear;
-        int m_endYear;
-    };
+    // True if every year in [startYear, endYear] has measurements of type on at least minFraction of its days.
+    // Answered from the bitmaps in the binary sidecar. Without a valid sidecar the station is loaded once to write it.
+    bool
+    hasCompleteMeasurements(const std::string& stationId, int startYear, int endYear, MeasurementType type, double minFraction);
+
+    // Loads the selected measurements of a station ahead of several queries (e. g. TMAX and TMIN for all
+    // seasons), so the queries do not widen the cached selection one by one. Returns false if nothing was found.
+    bool
+    preloadMeasurements(const std::string& stationId, const MeasurementFilter& filter);
+
+    // Upper bound for the measurements kept in memory (see MeasurementsCache).
+    void
+    setCacheByteBudget(std::size_t byteBudget) {m_MeasurementsCache.setByteBudget(byteBudget);};
+
+    const MeasurementsCache::Statistics&
+    cacheStatistics() const {return m_MeasurementsCache.statistics();};
 
 private:
 
@@ -113,27 +141,46 @@ private:
     const std::string m_inventoryFileName;
     const std::string m_csvExt;
 
-    std::unique_ptr<std::vector<Station>> m_StationsCache;  // all available stations
+    // All available stations and the inventory. Loaded from the snapshot if it is up to date,
+    // otherwise parsed and written to the snapshot.
+    StationMetadata m_metadata;
 
-    std::unique_ptr<std::vector<InventoryEntry>> m_stationInventory;
+    // Station IDs of the public functions are converted to StationKey on entry, containers are keyed by it.
 
-    // Measurements for previously accessed stations. TODO: LRU cache.
-    std::map<std::string, std::unique_ptr<std::vector<Measurement>>> m_MeasurementsCache;
+    // Measurements, days with data and monthly sums and counts for recently accessed stations, least recently
+    // used ones are evicted beyond the budget. A query not covered by the cached selection loads the station
+    // again with both selections combined. All averages are computed from the monthly sums and counts.
+    MeasurementsCache m_MeasurementsCache;
 
+    // Readers of stations and inventory, then onReady.
+    std::future<void> m_ready;
+
+    // Text parsers. Each fills its part of m_metadata, so they can run concurrently.
     bool readStations();
     bool readInventory();
 
     double haversine(double lat1,  double lat2, double lng1, double lng2);
+    // Same with radians and cosines of the latitudes already computed (see StationMetadata).
+    static double haversineRadians(double r_lat1, double r_lat2, double r_lng1, double r_lng2, double cos_lat1, double cos_lat2);
 
     std::unique_ptr<std::vector<std::pair<int, double>>>
-    calcNearestStations(double latitude, double longitude, int radius);
+    calcNearestStations(double latitude, double longitude, int radius, std::size_t top,
+                        const std::function<bool(std::uint32_t)>& accept = {});
+
+    const std::string csvFilenameFromStationId(StationKey key);
+
+    // Loads at least the selected measurements: the selection from a valid binary sidecar, otherwise all
+    // measurements from the station file, which also writes the sidecar.
+    bool readMeasurementsForStation(StationKey key, const MeasurementFilter& filter = MeasurementFilter::all());
 
-    const std::string csvFilenameFromStationId(const std::string& station_id);
+    static bool readTextFile(const std::string& filename, std::string& text);
 
-    bool readMeasurementsForStation(const std::string& stationId);
+    // Sums and counts of the station, at least for the selected measurements: from memory, else from the
+    // binary sidecar, else built from a load (see readMeasurementsForStation). nullptr if nothing was found.
+    const MonthlyAggregates* aggregatesForStation(StationKey key, const MeasurementFilter& filter);
 
-    std::span<const Measurement>
-    calcMeasurementSpanForYearRange(const std::unique_ptr<std::vector<Measurement>>& measurements, int startYear, int endYear);
+    // Average of the scaled values. total must not be empty.
+    static float average(const MonthlyAggregates::Total& total, float scaling);
 };
 
 #endif // DATAPROVIDER_HPP
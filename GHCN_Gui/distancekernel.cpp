@@ -0,0 +1,149 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define GHCN_DISTANCEKERNEL_AVX2
+#include <immintrin.h>
+#endif
+
+#include "distancekernel.hpp"
+
+
+static std::atomic<bool> s_simdEnabled{true};
+
+
+static void
+squaredDistancesScalar(const double* x, const double* y, const double* z, std::size_t count, const double* query, double* distances)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        const double dx = x[i] - query[0];
+        const double dy = y[i] - query[1];
+        const double dz = z[i] - query[2];
+        distances[i] = dx * dx + dy * dy + dz * dz;
+    }
+}
+
+
+static void
+selectWithinScalar(const double* x, const double* y, const double* z, const std::uint32_t* ids, std::size_t count,
+                   const double* query, double maxDistance2, std::vector<std::uint32_t>& result)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        const double dx = x[i] - query[0];
+        const double dy = y[i] - query[1];
+        const double dz = z[i] - query[2];
+        if (dx * dx + dy * dy + dz * dz <= maxDistance2) {
+            result.push_back(ids[i]);
+        }
+    }
+}
+
+
+#ifdef GHCN_DISTANCEKERNEL_AVX2
+
+// Squared distances of the four points at i. Multiply and add separately: same rounding as the scalar loop.
+__attribute__((target("avx2")))
+static inline __m256d
+squaredDistances4(const double* x, const double* y, const double* z, std::size_t i, __m256d qx, __m256d qy, __m256d qz)
+{
+    const __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + i), qx);
+    const __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + i), qy);
+    const __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(z + i), qz);
+    return _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), _mm256_mul_pd(dz, dz));
+}
+
+
+__attribute__((target("avx2")))
+static void
+squaredDistancesAvx2(const double* x, const double* y, const double* z, std::size_t count, const double* query, double* distances)
+{
+    const __m256d qx = _mm256_set1_pd(query[0]);
+    const __m256d qy = _mm256_set1_pd(query[1]);
+    const __m256d qz = _mm256_set1_pd(query[2]);
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm256_storeu_pd(distances + i, squaredDistances4(x, y, z, i, qx, qy, qz));
+    }
+    squaredDistancesScalar(x + i, y + i, z + i, count - i, query, distances + i);
+}
+
+
+__attribute__((target("avx2")))
+static void
+selectWithinAvx2(const double* x, const double* y, const double* z, const std::uint32_t* ids, std::size_t count,
+                 const double* query, double maxDistance2, std::vector<std::uint32_t>& result)
+{
+    const __m256d qx = _mm256_set1_pd(query[0]);
+    const __m256d qy = _mm256_set1_pd(query[1]);
+    const __m256d qz = _mm256_set1_pd(query[2]);
+    const __m256d limit = _mm256_set1_pd(maxDistance2);
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d d2 = squaredDistances4(x, y, z, i, qx, qy, qz);
+        // Most points are far away: one test per four points.
+        int mask = _mm256_movemask_pd(_mm256_cmp_pd(d2, limit, _CMP_LE_OQ));
+        while (mask != 0) {
+            result.push_back(ids[i + __builtin_ctz(static_cast<unsigned>(mask))]);
+            mask &= mask - 1;
+        }
+    }
+    selectWithinScalar(x + i, y + i, z + i, ids + i, count - i, query, maxDistance2, result);
+}
+
+
+static bool
+avx2Supported()
+{
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+#endif // GHCN_DISTANCEKERNEL_AVX2
+
+
+void
+DistanceKernel::squaredDistances(const double* x, const double* y, const double* z, std::size_t count,
+                                 const double* query, double* distances)
+{
+#ifdef GHCN_DISTANCEKERNEL_AVX2
+    if (usesSimd()) {
+        squaredDistancesAvx2(x, y, z, count, query, distances);
+        return;
+    }
+#endif
+    squaredDistancesScalar(x, y, z, count, query, distances);
+}
+
+
+void
+DistanceKernel::selectWithin(const double* x, const double* y, const double* z, const std::uint32_t* ids, std::size_t count,
+                             const double* query, double maxDistance2, std::vector<std::uint32_t>& result)
+{
+#ifdef GHCN_DISTANCEKERNEL_AVX2
+    if (usesSimd()) {
+        selectWithinAvx2(x, y, z, ids, count, query, maxDistance2, result);
+        return;
+    }
+#endif
+    selectWithinScalar(x, y, z, ids, count, query, maxDistance2, result);
+}
+
+
+bool
+DistanceKernel::usesSimd()
+{
+#ifdef GHCN_DISTANCEKERNEL_AVX2
+    return avx2Supported() && s_simdEnabled.load(std::memory_order_relaxed);
+#else
+    return false;
+#endif
+}
+
+
+void
+DistanceKernel::enableSimd(bool enabled)
+{
+    s_simdEnabled.store(enabled, std::memory_order_relaxed);
+}
@@ -0,0 +1,35 @@
+#ifndef DISTANCEKERNEL_HPP
+#define DISTANCEKERNEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+    Batch distance computations over points stored column-wise (x, y and z in separate arrays).
+
+    Points are unit vectors (see SpatialIndex), distances are squared chord lengths: three
+    subtractions, three multiplications and two additions per point, no trigonometry. On x86-64
+    CPUs with AVX2 four points are processed per instruction, chosen at runtime with
+    __builtin_cpu_supports. Elsewhere, and when SIMD is disabled, the scalar loop is used.
+    Both paths round identically (no fused multiply-add), so results do not depend on the CPU.
+*/
+class DistanceKernel
+{
+public:
+    // distances[i] = squared distance between query (x, y, z) and point i, for i in [0, count).
+    static void squaredDistances(const double* x, const double* y, const double* z, std::size_t count,
+                                 const double* query, double* distances);
+
+    // Appends ids[i] to result for every point i within maxDistance2 (squared) of the query.
+    static void selectWithin(const double* x, const double* y, const double* z, const std::uint32_t* ids, std::size_t count,
+                             const double* query, double maxDistance2, std::vector<std::uint32_t>& result);
+
+    // True if the AVX2 path is in use.
+    static bool usesSimd();
+
+    // Allows or forbids the AVX2 path (e. g. to compare both in a benchmark). Allowed by default.
+    static void enableSimd(bool enabled);
+};
+
+#endif // DISTANCEKERNEL_HPP
@@ -0,0 +1,224 @@
+#ifndef ELEMENTREGISTRY_HPP
+#define ELEMENTREGISTRY_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/*
+       Elements of measurement according to GHCN readme.txt, retrieved from
+
+       https://www1.ncdc.noaa.gov/pub/data/ghcn/daily/readme.txt
+
+       Every documented element gets a MeasurementType. Per element, the registry knows the
+       code, the factor converting stored values into the unit shown to the user, and that unit.
+
+       The named elements are listed once in GHCN_ELEMENTS, which generates both the enum and
+       the table, so the two cannot drift apart. The soil temperature families SN*# and SX*#
+       (* = ground cover 0..8, # = depth code 1..7) are generated by loops.
+
+       Core elements (PRCP, SNOW, SNWD, TMAX, TMIN) come first. Their values are unchanged.
+*/
+#define GHCN_ELEMENTS(X) \
+    X(PRCP, 0.1f, "mm")    /* Precipitation (tenths of mm) */ \
+    X(SNOW, 0.1f, "cm")    /* Snowfall (mm) */ \
+    X(SNWD, 0.1f, "cm")    /* Snow depth (mm) */ \
+    X(TMAX, 0.1f, "degC")  /* Maximum temperature (tenths of degrees C) */ \
+    X(TMIN, 0.1f, "degC")  /* Minimum temperature (tenths of degrees C) */ \
+    X(ACMC, 1.0f, "%")     /* Average cloudiness midnight to midnight, ceilometer */ \
+    X(ACMH, 1.0f, "%")     /* Average cloudiness midnight to midnight, manual */ \
+    X(ACSC, 1.0f, "%")     /* Average cloudiness sunrise to sunset, ceilometer */ \
+    X(ACSH, 1.0f, "%")     /* Average cloudiness sunrise to sunset, manual */ \
+    X(ADPT, 0.1f, "degC")  /* Average dew point temperature */ \
+    X(ASLP, 0.1f, "hPa")   /* Average sea level pressure (hPa * 10) */ \
+    X(ASTP, 0.1f, "hPa")   /* Average station level pressure (hPa * 10) */ \
+    X(AWBT, 0.1f, "degC")  /* Average wet bulb temperature */ \
+    X(AWDR, 1.0f, "deg")   /* Average daily wind direction */ \
+    X(AWND, 0.1f, "m/s")   /* Average daily wind speed (tenths of m/s) */ \
+    X(DAEV, 1.0f, "days")  /* Days included in MDEV */ \
+    X(DAPR, 1.0f, "days")  /* Days included in MDPR */ \
+    X(DASF, 1.0f, "days")  /* Days included in MDSF */ \
+    X(DATN, 1.0f, "days")  /* Days included in MDTN */ \
+    X(DATX, 1.0f, "days")  /* Days included in MDTX */ \
+    X(DAWM, 1.0f, "days")  /* Days included in MDWM */ \
+    X(DWPR, 1.0f, "days")  /* Days with non-zero precipitation included in MDPR */ \
+    X(EVAP, 0.1f, "mm")    /* Evaporation from evaporation pan (tenths of mm) */ \
+    X(FMTM, 1.0f, "hhmm")  /* Time of fastest mile or fastest 1-minute wind */ \
+    X(FRGB, 1.0f, "cm")    /* Base of frozen ground layer */ \
+    X(FRGT, 1.0f, "cm")    /* Top of frozen ground layer */ \
+    X(FRTH, 1.0f, "cm")    /* Thickness of frozen ground layer */ \
+    X(GAHT, 1.0f, "cm")    /* Difference between river and gauge height */ \
+    X(MDEV, 0.1f, "mm")    /* Multiday evaporation total (tenths of mm) */ \
+    X(MDPR, 0.1f, "mm")    /* Multiday precipitation total (tenths of mm) */ \
+    X(MDSF, 0.1f, "cm")    /* Multiday snowfall total (mm) */ \
+    X(MDTN, 0.1f, "degC")  /* Multiday minimum temperature */ \
+    X(MDTX, 0.1f, "degC")  /* Multiday maximum temperature */ \
+    X(MDWM, 1.0f, "km")    /* Multiday wind movement */ \
+    X(MNPN, 0.1f, "degC")  /* Minimum water temperature in evaporation pan */ \
+    X(MXPN, 0.1f, "degC")  /* Maximum water temperature in evaporation pan */ \
+    X(PGTM, 1.0f, "hhmm")  /* Peak gust time */ \
+    X(PSUN, 1.0f, "%")     /* Percent of possible sunshine */ \
+    X(RHAV, 1.0f, "%")     /* Average relative humidity */ \
+    X(RHMN, 1.0f, "%")     /* Minimum relative humidity */ \
+    X(RHMX, 1.0f, "%")     /* Maximum relative humidity */ \
+    X(TAVG, 0.1f, "degC")  /* Average temperature (tenths of degrees C) */ \
+    X(THIC, 0.1f, "mm")    /* Thickness of ice on water (tenths of mm) */ \
+    X(TOBS, 0.1f, "degC")  /* Temperature at the time of observation */ \
+    X(TSUN, 1.0f, "min")   /* Daily total sunshine */ \
+    X(WDF1, 1.0f, "deg")   /* Direction of fastest 1-minute wind */ \
+    X(WDF2, 1.0f, "deg")   /* Direction of fastest 2-minute wind */ \
+    X(WDF5, 1.0f, "deg")   /* Direction of fastest 5-second wind */ \
+    X(WDFG, 1.0f, "deg")   /* Direction of peak wind gust */ \
+    X(WDFI, 1.0f, "deg")   /* Direction of highest instantaneous wind */ \
+    X(WDFM, 1.0f, "deg")   /* Fastest mile wind direction */ \
+    X(WDMV, 1.0f, "km")    /* 24-hour wind movement */ \
+    X(WESD, 0.1f, "mm")    /* Water equivalent of snow on the ground (tenths of mm) */ \
+    X(WESF, 0.1f, "mm")    /* Water equivalent of snowfall (tenths of mm) */ \
+    X(WSF1, 0.1f, "m/s")   /* Fastest 1-minute wind speed */ \
+    X(WSF2, 0.1f, "m/s")   /* Fastest 2-minute wind speed */ \
+    X(WSF5, 0.1f, "m/s")   /* Fastest 5-second wind speed */ \
+    X(WSFG, 0.1f, "m/s")   /* Peak gust wind speed */ \
+    X(WSFI, 0.1f, "m/s")   /* Highest instantaneous wind speed */ \
+    X(WSFM, 0.1f, "m/s")   /* Fastest mile wind speed */ \
+    X(WT01, 1.0f, "")      /* Weather type: fog, ice fog or freezing fog (1 = yes) */ \
+    X(WT02, 1.0f, "")      /* Heavy fog */ \
+    X(WT03, 1.0f, "")      /* Thunder */ \
+    X(WT04, 1.0f, "")      /* Ice pellets, sleet, snow pellets or small hail */ \
+    X(WT05, 1.0f, "")      /* Hail */ \
+    X(WT06, 1.0f, "")      /* Glaze or rime */ \
+    X(WT07, 1.0f, "")      /* Dust, volcanic ash, blowing dust, sand or obstruction */ \
+    X(WT08, 1.0f, "")      /* Smoke or haze */ \
+    X(WT09, 1.0f, "")      /* Blowing or drifting snow */ \
+    X(WT10, 1.0f, "")      /* Tornado, waterspout or funnel cloud */ \
+    X(WT11, 1.0f, "")      /* High or damaging winds */ \
+    X(WT12, 1.0f, "")      /* Blowing spray */ \
+    X(WT13, 1.0f, "")      /* Mist */ \
+    X(WT14, 1.0f, "")      /* Drizzle */ \
+    X(WT15, 1.0f, "")      /* Freezing drizzle */ \
+    X(WT16, 1.0f, "")      /* Rain */ \
+    X(WT17, 1.0f, "")      /* Freezing rain */ \
+    X(WT18, 1.0f, "")      /* Snow, snow pellets, snow grains or ice crystals */ \
+    X(WT19, 1.0f, "")      /* Unknown source of precipitation */ \
+    X(WT21, 1.0f, "")      /* Ground fog */ \
+    X(WT22, 1.0f, "")      /* Ice fog or freezing fog */ \
+    X(WV01, 1.0f, "")      /* Weather in the vicinity: fog */ \
+    X(WV03, 1.0f, "")      /* Thunder */ \
+    X(WV07, 1.0f, "")      /* Ash, dust, sand or other obstruction */ \
+    X(WV18, 1.0f, "")      /* Snow or ice crystals */ \
+    X(WV20, 1.0f, "")      /* Rain or snow shower */
+
+#define GHCN_ELEMENT_ENUMERATOR(code, scaling, unit) code,
+
+enum class MeasurementType : std::uint8_t
+{
+    GHCN_ELEMENTS(GHCN_ELEMENT_ENUMERATOR)
+    SN_FIRST,                // SN*#: minimum soil temperature, 63 consecutive values
+    SX_FIRST = SN_FIRST + 63,  // SX*#: maximum soil temperature, 63 consecutive values
+    UNKNOWN = SX_FIRST + 63
+};
+
+#undef GHCN_ELEMENT_ENUMERATOR
+
+
+struct ElementInfo
+{
+    char code[5];           // Four characters and terminating zero. Empty for UNKNOWN.
+    float scaling;          // Factor to convert stored values into unit.
+    std::string_view unit;  // Empty for dimensionless elements (weather types).
+};
+
+inline constexpr std::size_t s_numElementTypes{static_cast<std::size_t>(MeasurementType::UNKNOWN) + 1};
+
+
+// Soil temperature element for ground cover 0..8 and depth code 1..7 (SN / SX followed by both digits).
+constexpr MeasurementType
+soilTemperatureType(bool maximum, int groundCover, int depth)
+{
+    const int first = static_cast<int>(maximum ? MeasurementType::SX_FIRST : MeasurementType::SN_FIRST);
+    return static_cast<MeasurementType>(first + groundCover * 7 + (depth - 1));
+}
+
+
+// Indexed by MeasurementType.
+inline constexpr std::array<ElementInfo, s_numElementTypes> s_elementInfo = []() {
+    std::array<ElementInfo, s_numElementTypes> table{};
+    std::size_t i{0};
+#define GHCN_ELEMENT_INFO(code, scaling, unit) table[i++] = ElementInfo{#code, scaling, unit};
+    GHCN_ELEMENTS(GHCN_ELEMENT_INFO)
+#undef GHCN_ELEMENT_INFO
+    for (bool maximum : {false, true}) {
+        for (int groundCover = 0; groundCover <= 8; ++groundCover) {
+            for (int depth = 1; depth <= 7; ++depth) {
+                ElementInfo& info = table[static_cast<std::size_t>(soilTemperatureType(maximum, groundCover, depth))];
+                info = ElementInfo{{'S', maximum ? 'X' : 'N', static_cast<char>('0' + groundCover), static_cast<char>('0' + depth), '\0'},
+                                   0.1f, "degC"};
+            }
+        }
+    }
+    table[static_cast<std::size_t>(MeasurementType::UNKNOWN)] = ElementInfo{"", 1.0f, ""};
+    return table;
+}();
+
+#undef GHCN_ELEMENTS
+
+
+/*
+    Lookup by code.
+
+    Element codes are four ASCII characters, packed into a uint32 (first character in the most
+    significant byte). The registry keeps the packed codes sorted, so lookup is a binary search
+    over about 200 integers: no allocation, no map, no exception for unknown codes.
+*/
+constexpr std::uint32_t
+elementKey(std::string_view code)
+{
+    if (code.size() != 4) {
+        return 0;
+    }
+    return (static_cast<std::uint32_t>(static_cast<unsigned char>(code[0])) << 24) |
+           (static_cast<std::uint32_t>(static_cast<unsigned char>(code[1])) << 16) |
+           (static_cast<std::uint32_t>(static_cast<unsigned char>(code[2])) << 8) |
+           static_cast<std::uint32_t>(static_cast<unsigned char>(code[3]));
+}
+
+
+struct ElementKey
+{
+    std::uint32_t key;
+    MeasurementType type;
+};
+
+// All known elements (UNKNOWN excluded), sorted by key.
+inline constexpr std::array<ElementKey, s_numElementTypes - 1> s_elementKeys = []() {
+    std::array<ElementKey, s_numElementTypes - 1> keys{};
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = ElementKey{elementKey(s_elementInfo[i].code), static_cast<MeasurementType>(i)};
+    }
+    std::ranges::sort(keys, {}, &ElementKey::key);
+    return keys;
+}();
+
+static_assert(std::ranges::adjacent_find(s_elementKeys, {}, &ElementKey::key) == s_elementKeys.end(),
+              "element codes must be unique");
+static_assert(s_elementKeys.front().key != 0, "every element needs a four character code");
+
+
+// Returns MeasurementType::UNKNOWN for codes not in the registry.
+constexpr MeasurementType
+measurementTypeFromKey(std::uint32_t key)
+{
+    const auto it = std::ranges::lower_bound(s_elementKeys, key, {}, &ElementKey::key);
+    return (it != s_elementKeys.end() && it->key == key) ? it->type : MeasurementType::UNKNOWN;
+}
+
+
+constexpr const ElementInfo&
+elementInfo(MeasurementType type)
+{
+    const auto index = static_cast<std::size_t>(type);
+    return s_elementInfo[index < s_numElementTypes ? index : static_cast<std::size_t>(MeasurementType::UNKNOWN)];
+}
+
+#endif // ELEMENTREGISTRY_HPP
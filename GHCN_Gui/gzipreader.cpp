@@ -0,0 +1,204 @@
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef GHCN_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "gzipreader.hpp"
+
+
+#ifdef GHCN_HAVE_ZLIB
+
+namespace {
+
+/*
+    Hand-over between the inflating worker and the consuming caller.
+
+    A fixed number of buffers circulates between the free list and the queue of filled blocks,
+    so the worker can run at most s_numBlocks ahead and no block is allocated twice.
+*/
+class BlockChannel
+{
+public:
+    explicit BlockChannel(std::size_t numBlocks) : m_free(numBlocks) {};
+
+    // Worker: waits for an empty buffer. Returns false if the consumer has cancelled.
+    bool takeFree(std::string& block)
+    {
+        std::unique_lock lock(m_mutex);
+        m_changed.wait(lock, [this]() {return !m_free.empty() || m_cancelled;});
+        if (m_cancelled) {
+            return false;
+        }
+        block = std::move(m_free.back());
+        m_free.pop_back();
+        return true;
+    };
+
+    void pushFilled(std::string&& block)
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_filled.push_back(std::move(block));
+        }
+        m_changed.notify_all();
+    };
+
+    void finish(bool failed)
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_finished = true;
+            m_failed = failed;
+        }
+        m_changed.notify_all();
+    };
+
+    // Consumer: waits for the next block. Returns false after the last one.
+    bool takeFilled(std::string& block)
+    {
+        std::unique_lock lock(m_mutex);
+        m_changed.wait(lock, [this]() {return !m_filled.empty() || m_finished;});
+        if (m_filled.empty()) {
+            return false;
+        }
+        block = std::move(m_filled.front());
+        m_filled.pop_front();
+        return true;
+    };
+
+    void giveBack(std::string&& block)
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_free.push_back(std::move(block));
+        }
+        m_changed.notify_all();
+    };
+
+    void cancel()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_cancelled = true;
+        }
+        m_changed.notify_all();
+    };
+
+    bool failed()
+    {
+        std::lock_guard lock(m_mutex);
+        return m_failed;
+    };
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::vector<std::string> m_free;
+    std::deque<std::string> m_filled;
+    bool m_finished{false};
+    bool m_failed{false};
+    bool m_cancelled{false};
+};
+
+}  // namespace
+
+
+bool
+GzipReader::readLines(const std::string& filename, const TextConsumer& consumer)
+{
+    gzFile file = gzopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    gzbuffer(file, 256 * 1024);  // Compressed input is read in large chunks, too.
+
+    BlockChannel channel(s_numBlocks);
+    std::thread worker([file, &channel]() {
+        bool failed{false};
+        std::string block;
+        while (channel.takeFree(block)) {
+            block.resize(s_blockSize);
+            const int size = gzread(file, block.data(), static_cast<unsigned>(block.size()));
+            if (size <= 0) {
+                int error{Z_OK};
+                gzerror(file, &error);
+                failed = size < 0 || error != Z_OK;  // e. g. truncated file
+                break;
+            }
+            block.resize(static_cast<std::size_t>(size));
+            channel.pushFilled(std::move(block));
+        }
+        channel.finish(failed);
+    });
+
+    try {
+        // A block ends anywhere. The incomplete last line is carried over and completed by the next block.
+        std::string carry;
+        std::string block;
+        while (channel.takeFilled(block)) {
+            const std::string_view text(block);
+            const std::size_t lastBreak = text.rfind('\n');
+            if (lastBreak == std::string_view::npos) {
+                carry.append(text);  // Line longer than a block
+            } else {
+                std::string_view complete = text.substr(0, lastBreak + 1);
+                if (!carry.empty()) {
+                    const std::size_t firstBreak = complete.find('\n');
+                    carry.append(complete.substr(0, firstBreak + 1));
+                    consumer(carry);
+                    carry.clear();
+                    complete.remove_prefix(firstBreak + 1);
+                }
+                if (!complete.empty()) {
+                    consumer(complete);  // Bulk of the block, without copying
+                }
+                carry.assign(text.substr(lastBreak + 1));
+            }
+            channel.giveBack(std::move(block));
+        }
+        if (!carry.empty()) {
+            consumer(carry);  // Last line without line break
+        }
+    } catch (...) {
+        channel.cancel();
+        worker.join();
+        gzclose(file);
+        throw;
+    }
+    worker.join();
+    gzclose(file);
+    return !channel.failed();
+}
+
+
+bool
+GzipReader::isAvailable()
+{
+    return true;
+}
+
+#else  // GHCN_HAVE_ZLIB
+
+bool
+GzipReader::readLines(const std::string& /* filename */, const TextConsumer& /* consumer */)
+{
+    return false;  // Built without zlib
+}
+
+
+bool
+GzipReader::isAvailable()
+{
+    return false;
+}
+
+#endif  // GHCN_HAVE_ZLIB
@@ -0,0 +1,40 @@
+#ifndef GZIPREADER_HPP
+#define GZIPREADER_HPP
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/*
+    Streaming reader for gzip compressed text files (e. g. GME00102380.csv.gz, 2023.csv.gz).
+
+    A worker thread inflates the file block by block into a small ring of buffers, while the
+    calling thread consumes the blocks. Decompression of block n+1 overlaps with processing of
+    block n and nothing is decompressed to disk. Concatenated gzip members are read as one stream.
+
+    Requires zlib (GHCN_HAVE_ZLIB, set by CMake if zlib is found). Without it isAvailable()
+    returns false and readLines() fails for every file.
+*/
+class GzipReader
+{
+public:
+    using TextConsumer = std::function<void(std::string_view text)>;
+
+    // Hands the decompressed text to consumer in file order. Every call receives complete lines only
+    // (the last line of the file may lack its line break). consumer runs on the calling thread.
+    // Returns false if the file cannot be opened or contains corrupt data. In the latter case
+    // consumer may already have received the text before the corruption.
+    static bool readLines(const std::string& filename, const TextConsumer& consumer);
+
+    static bool isAvailable();
+
+    static bool isGzipFilename(std::string_view filename) {return filename.ends_with(s_extension);};
+
+    static constexpr std::string_view s_extension{".gz"};
+
+    static constexpr std::size_t s_blockSize{1 << 20};  // Decompressed bytes per block
+    static constexpr std::size_t s_numBlocks{4};        // Blocks in flight between the threads
+};
+
+#endif // GZIPREADER_HPP
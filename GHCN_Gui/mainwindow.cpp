@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cmath>
 #include <format>
 
@@ -10,14 +11,23 @@
 #include "ui_mainwindow.h"
 
 #include "measurement.hpp"
+#include "measurementfilter.hpp"
 #include "dataprovider.hpp"
 
 
 MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent), ui(new Ui::MainWindow), m_dataProvider("../../data/", "ghcnd-stations.txt", "ghcnd-inventory.txt", ".csv")
+    : QMainWindow(parent), ui(new Ui::MainWindow),
+    m_dataProvider("../../data/", "ghcnd-stations.txt", "ghcnd-inventory.txt", ".csv", [this]() {
+        // Called on a worker thread: queued into the event loop, which runs it after the constructor.
+        QMetaObject::invokeMethod(this, [this]() {onDataProviderReady();}, Qt::QueuedConnection);
+    })
 {
     this->ui->setupUi(this);  // constructs the widget hierarchy (ui_mainwindow.h)
 
+    // Station search needs stations and inventory, which are still being read.
+    this->ui->btn_update->setEnabled(false);
+    this->statusBar()->showMessage("Reading stations and inventory ...");
+
     // Experimental
     // m_checkBoxFunc.emplace(this->ui->chk_tmax_year, [this](){qDebug() << this->ui->chk_tmax_year->objectName();});
 
@@ -145,6 +155,13 @@ void MainWindow::updateGraphs()
     this->yearTracer->setVisible(false);
     this->statusBar()->clearMessage();
 
+    // All graphs below use TMAX and TMIN of the selected years. Load both at once.
+    // One year more at the start for seasons reaching over the turn of the year.
+    m_dataProvider.preloadMeasurements(this->ui->cmb_stations->currentText().toStdString(),
+                                       MeasurementFilter({MeasurementType::TMAX, MeasurementType::TMIN},
+                                                         this->ui->spb_startyear->value() - 1,
+                                                         this->ui->spb_endyear->value()));
+
     if (this->ui->chk_tmax_spring->isChecked()) {
         this->addGraph(MeasurementType::TMAX, Season::SPRING, "TMAX Spring",
                        QColor(m_seasonGraphConfig.at(Season::SPRING).maxColor().c_str()));
@@ -370,28 +387,28 @@ void MainWindow::onStationSelectionChanged()
 }
 
 
+void MainWindow::onDataProviderReady()
+{
+    this->ui->btn_update->setEnabled(true);
+    this->statusBar()->clearMessage();
+}
+
+
 void MainWindow::on_btn_update_clicked()
 {
     *m_previousSearchParameters = *m_currentSearchParameters;
     this->ui->cmb_stations->clear();
+    const std::size_t top = static_cast<std::size_t>(std::max(1, m_currentSearchParameters->top()));
     auto nearestStations = m_dataProvider.getNearestStations(m_currentSearchParameters->latitude(),
                                                              m_currentSearchParameters->longitude(),
-                                                             m_currentSearchParameters->radius());
+                                                             m_currentSearchParameters->radius(),
+                                                             top,
+                                                             m_currentSearchParameters->startYear(),
+                                                             m_currentSearchParameters->endYear(),
+                                                             {MeasurementType::TMAX, MeasurementType::TMIN});
 
     for (const std::pair<std::string, double>& stationData : *nearestStations) {
-        bool hasTmax = m_dataProvider.hasMeasurementsForYearRange(stationData.first,
-                                                                  m_currentSearchParameters->startYear(),
-                                                                  m_currentSearchParameters->endYear(),
-                                                                  MeasurementType::TMAX);
-
-        bool hasTmin = m_dataProvider.hasMeasurementsForYearRange(stationData.first,
-                                                                  m_currentSearchParameters->startYear(),
-                                                                  m_currentSearchParameters->endYear(),
-                                                                  MeasurementType::TMIN);
-
-        if (hasTmax && hasTmin) {
-            this->ui->cmb_stations->addItem(stationData.first.c_str(), stationData.second);
-        }
+        this->ui->cmb_stations->addItem(stationData.first.c_str(), stationData.second);
     }
 }
 
@@ -173,6 +173,7 @@ private:
     void updateGraphs();
     void onStationSelectionChanged();
     void onStationSearchTriggered();
+    void onDataProviderReady();
 };
 
 #endif // MAINWINDOW_H
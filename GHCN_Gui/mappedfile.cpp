@@ -0,0 +1,84 @@
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define GHCN_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define GHCN_HAVE_WIN32_MAPPING
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+#include "mappedfile.hpp"
+
+
+MappedFile::MappedFile(const std::string& filename)
+{
+#if defined(GHCN_HAVE_MMAP)
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat fileStat;
+    if (::fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+        void* addr = ::mmap(nullptr, static_cast<std::size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            m_data = static_cast<const char*>(addr);
+            m_size = static_cast<std::size_t>(fileStat.st_size);
+        }
+    }
+    ::close(fd);  // The mapping stays valid after closing the descriptor.
+#elif defined(GHCN_HAVE_WIN32_MAPPING)
+    HANDLE file = ::CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    LARGE_INTEGER fileSize;
+    if (::GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr) {
+            void* addr = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (addr != nullptr) {
+                m_data = static_cast<const char*>(addr);
+                m_size = static_cast<std::size_t>(fileSize.QuadPart);
+            }
+            ::CloseHandle(mapping);  // The view keeps the mapping alive.
+        }
+    }
+    ::CloseHandle(file);
+#else
+    (void)filename;
+#endif
+}
+
+
+MappedFile::~MappedFile()
+{
+    if (m_data == nullptr) {
+        return;
+    }
+#if defined(GHCN_HAVE_MMAP)
+    ::munmap(const_cast<char*>(m_data), m_size);
+#elif defined(GHCN_HAVE_WIN32_MAPPING)
+    ::UnmapViewOfFile(m_data);
+#endif
+}
+
+
+void
+MappedFile::adviseSequential() const
+{
+#if defined(GHCN_HAVE_MMAP)
+    if (m_data != nullptr) {
+        // Advice values are not flags and can not be combined.
+        ::madvise(const_cast<char*>(m_data), m_size, MADV_SEQUENTIAL);
+        ::madvise(const_cast<char*>(m_data), m_size, MADV_WILLNEED);
+    }
+#endif
+    // Windows: sequential access is requested by FILE_FLAG_SEQUENTIAL_SCAN when opening the file.
+}
@@ -0,0 +1,37 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/*
+    Read-only memory mapping of a complete file.
+
+    The mapping is released when the object goes out of scope.
+    Implemented with mmap on POSIX systems and with file mapping objects on Windows.
+    For files that cannot be mapped (e. g. empty files) and on other systems isValid()
+    returns false and the caller has to fall back to stream based reading.
+*/
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isValid() const {return m_data != nullptr;};
+
+    std::string_view view() const {return std::string_view(m_data, m_size);};
+
+    // Hint to the kernel that the mapping is read front to back (read-ahead, early page release).
+    void adviseSequential() const;
+
+private:
+    const char* m_data{nullptr};
+    std::size_t m_size{0};
+};
+
+#endif // MAPPEDFILE_HPP
@@ -1,63 +1,42 @@
-#include <string>
-#include <map>
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <string_view>
 
 #include "measurement.hpp"
 
 using namespace std;
 
-Measurement::Measurement(const string& date, const int& value, const string& element)
-    : m_value{value} {
-    
-        m_year = stoi(date.substr(0, 4));
-        m_month = stoi(date.substr(4, 2));
-        m_day = stoi(date.substr(6, 2));
-        if (s_mapStringMeasurementType.find(element) == s_mapStringMeasurementType.end()) {
-            m_type = MeasurementType::UNKNOWN;
-            // cout << format("Unknown measurement type {}\n", element);
-            } 
-        else {
-            m_type = s_mapStringMeasurementType[element];
-            }
-    }
-    
-const int& Measurement::getYear() const {
-    return m_year;
-    }
-
-const int& Measurement::getMonth() const {
-    return m_month;
-    }
-
-const int& Measurement::getDay() const {
-    return m_day;
+static_assert(Measurement::typeFromString("TMAX") == MeasurementType::TMAX);
+static_assert(Measurement::typeFromString("TMIN") == MeasurementType::TMIN);
+static_assert(Measurement::typeFromString("TAVG") == MeasurementType::TAVG);
+static_assert(Measurement::typeFromString("WT22") == MeasurementType::WT22);
+static_assert(Measurement::typeFromString("SX32") == soilTemperatureType(true, 3, 2));
+static_assert(Measurement::typeFromString("WT20") == MeasurementType::UNKNOWN);
+static_assert(Measurement::getCodeForType(soilTemperatureType(false, 8, 7)) == "SN87");
+static_assert(Measurement::getScalingForType(MeasurementType::TMAX) == 0.1f);
+static_assert(Measurement::typeFromString("TMAXX") == MeasurementType::UNKNOWN);
+
+Measurement::Measurement(string_view date, int value, string_view element)
+    : m_date{0}, m_value{clampValue(value)}, m_type{typeFromString(element)} {
+
+        int year{0};
+        int month{0};
+        int day{0};
+        if (date.size() >= 8) {
+            from_chars(date.data(), date.data() + 4, year);
+            from_chars(date.data() + 4, date.data() + 6, month);
+            from_chars(date.data() + 6, date.data() + 8, day);
+        }
+        m_date = packDate(year, month, day);
     }
     
-const int& Measurement::getValue() const {
-    return m_value;
-    }
-
-const MeasurementType& Measurement::getType() const {
-    return m_type;
+Measurement::Measurement(int year, int month, int day, int value, MeasurementType type)
+    : m_date{packDate(year, month, day)}, m_value{clampValue(value)}, m_type{type} {
     }
 
-const float& Measurement::getScalingForType(const MeasurementType& type) {
-    return s_mapMeasurementScaling[type];    
+int16_t Measurement::clampValue(int value) {
+    // Documented GHCN values fit into int16. Saturate anything else instead of wrapping around.
+    return static_cast<int16_t>(clamp(value, int{numeric_limits<int16_t>::min()}, int{numeric_limits<int16_t>::max()}));
     }
-    
-map<std::string, MeasurementType> Measurement::s_mapStringMeasurementType = {
-    {"PRCP", MeasurementType::PRCP},
-    {"SNOW", MeasurementType::SNOW},
-    {"SNWD", MeasurementType::SNWD},
-    {"TMIN", MeasurementType::TMIN},
-    {"TMAX", MeasurementType::TMAX}
-};
-    
-                                                                   
-map<MeasurementType, float> Measurement::s_mapMeasurementScaling = {
-    {MeasurementType::PRCP, 0.1f},
-    {MeasurementType::SNOW, 0.1f},
-    {MeasurementType::SNWD, 0.1f},
-    {MeasurementType::TMIN, 0.1f},
-    {MeasurementType::TMAX, 0.1f}
-};
-
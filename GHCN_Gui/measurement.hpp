@@ -1,61 +1,66 @@
 #ifndef MEASUREMENT_HPP
 #define MEASUREMENT_HPP
 
-#include <string>
-#include <map>
+#include <cstdint>
+#include <string_view>
+
+#include "elementregistry.hpp"
 
 /*
-       Core elements of measurement according to GHCN readme.txt, retrieved from
-       
-       https://www1.ncdc.noaa.gov/pub/data/ghcn/daily/readme.txt
-       
-       at April 7, 2024:
-       
-       PRCP = Precipitation (tenths of mm)
-   	   SNOW = Snowfall (mm)
-	   SNWD = Snow depth (mm)
-       TMAX = Maximum temperature (tenths of degrees C)
-       TMIN = Minimum temperature (tenths of degrees C)
-*/
-enum class MeasurementType
-{
-    PRCP, 
-    SNOW,
-    SNWD,
-    TMAX,
-    TMIN,
-    UNKNOWN
-};
+    Compact representation: 8 bytes per measurement.
 
+    m_date   packed date: year in bits 9..31, month in bits 5..8, day in bits 0..4.
+             Packed dates compare like the dates themselves.
+    m_value  GHCN data value. int16 covers the value range of all elements.
+    m_type   MeasurementType (1 byte). One byte padding remains.
 
+    Getters decode by shift and mask and are defined here, so they are inlined into the aggregation loops.
+*/
 class Measurement
 {
     public:
-        Measurement(const std::string& date, const int& value, const std::string& element);
+        // date: YYYYMMDD, element: four character code (e. g. "TMAX").
+        Measurement(std::string_view date, int value, std::string_view element);
 
-        const int& getYear() const;
-        
-        const int& getMonth() const;
-        
-        const int& getDay() const;
+        Measurement(int year, int month, int day, int value, MeasurementType type);
+
+        int getYear() const {return static_cast<int>(m_date >> 9);};
         
-        const int& getValue() const;
+        int getMonth() const {return static_cast<int>((m_date >> 5) & 0xF);};
         
-        const MeasurementType& getType() const;
+        int getDay() const {return static_cast<int>(m_date & 0x1F);};
+
+        std::uint32_t getPackedDate() const {return m_date;};
         
-        static const float& getScalingForType(const MeasurementType& type);
+        int getValue() const {return m_value;};
         
-        static std::map<std::string, MeasurementType> s_mapStringMeasurementType;
+        MeasurementType getType() const {return m_type;};
 
-        static std::map<MeasurementType, float> s_mapMeasurementScaling;
+        static constexpr std::uint32_t packDate(int year, int month, int day)
+        {
+            return (static_cast<std::uint32_t>(year) << 9) | (static_cast<std::uint32_t>(month) << 5) | static_cast<std::uint32_t>(day);
+        };
         
+        static constexpr float getScalingForType(MeasurementType type) {return elementInfo(type).scaling;};
+
+        static constexpr std::string_view getCodeForType(MeasurementType type) {return elementInfo(type).code;};
+
+        static constexpr std::string_view getUnitForType(MeasurementType type) {return elementInfo(type).unit;};
+
+        // Returns MeasurementType::UNKNOWN for elements not in the registry.
+        static constexpr MeasurementType typeFromString(std::string_view element)
+        {
+            return measurementTypeFromKey(elementKey(element));
+        };
+
     protected:
-        int m_year;
-        int m_month;
-        int m_day;
-        int m_value;
+        std::uint32_t m_date;
+        std::int16_t m_value;
         MeasurementType m_type;
+
+        static std::int16_t clampValue(int value);
 };
 
-#endif // MEASUREMENT_HPP
+static_assert(sizeof(Measurement) == 8, "Measurement must stay compact");
 
+#endif // MEASUREMENT_HPP
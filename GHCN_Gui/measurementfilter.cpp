@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <initializer_list>
+#include <limits>
+
+#include "measurement.hpp"
+#include "measurementfilter.hpp"
+
+
+MeasurementFilter::MeasurementFilter(std::initializer_list<MeasurementType> types, int firstYear, int lastYear)
+{
+    for (MeasurementType type : types) {
+        add(type, firstYear, lastYear);
+    }
+}
+
+
+MeasurementFilter
+MeasurementFilter::all()
+{
+    MeasurementFilter filter;
+    filter.m_windows.fill(Window{std::numeric_limits<int>::min(), std::numeric_limits<int>::max()});
+    return filter;
+}
+
+
+void
+MeasurementFilter::add(MeasurementType type, int firstYear, int lastYear)
+{
+    if (firstYear > lastYear) {
+        return;
+    }
+    Window& window = m_windows[index(type)];
+    if (window.empty()) {
+        window = Window{firstYear, lastYear};
+    } else {
+        window.first = std::min(window.first, firstYear);
+        window.last = std::max(window.last, lastYear);
+    }
+}
+
+
+void
+MeasurementFilter::add(const MeasurementFilter& other)
+{
+    for (std::size_t i = 0; i < m_windows.size(); ++i) {
+        add(static_cast<MeasurementType>(i), other.m_windows[i].first, other.m_windows[i].last);
+    }
+}
+
+
+bool
+MeasurementFilter::covers(const MeasurementFilter& other) const
+{
+    for (std::size_t i = 0; i < m_windows.size(); ++i) {
+        const Window& mine = m_windows[i];
+        const Window& theirs = other.m_windows[i];
+        if (!theirs.empty() && (mine.empty() || theirs.first < mine.first || theirs.last > mine.last)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,71 @@
+#ifndef MEASUREMENTFILTER_HPP
+#define MEASUREMENTFILTER_HPP
+
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+
+#include "measurement.hpp"
+
+/*
+    Selection of measurements to load: a year window per MeasurementType.
+
+    Parsers and the binary cache test element and year of a row against the filter before they
+    build a Measurement, so rows outside the selection cost a field comparison only.
+    DataProvider keeps the filter a station was loaded with as its coverage and loads again
+    when a query is not covered.
+
+    Adding a window to a type that already has one widens it to the enclosing window, so a
+    filter may select more than the union of what was added, never less.
+*/
+class MeasurementFilter
+{
+public:
+    // Selects nothing.
+    MeasurementFilter() = default;
+
+    MeasurementFilter(std::initializer_list<MeasurementType> types, int firstYear, int lastYear);
+
+    // Selects everything.
+    static MeasurementFilter all();
+
+    void add(MeasurementType type, int firstYear, int lastYear);
+
+    void add(const MeasurementFilter& other);
+
+    bool accepts(MeasurementType type, int year) const
+    {
+        const Window& window = m_windows[index(type)];
+        return window.first <= year && year <= window.last;
+    };
+
+    bool acceptsType(MeasurementType type) const {return !m_windows[index(type)].empty();};
+
+    // Selected years of the type. firstYear() > lastYear() if the type is not selected.
+    int firstYear(MeasurementType type) const {return m_windows[index(type)].first;};
+    int lastYear(MeasurementType type) const {return m_windows[index(type)].last;};
+
+    // True if every measurement selected by other is selected by this filter.
+    bool covers(const MeasurementFilter& other) const;
+
+    bool acceptsAll() const {return covers(all());};
+
+private:
+    struct Window
+    {
+        int first{1};
+        int last{0};  // first > last: nothing selected
+
+        bool empty() const {return first > last;};
+    };
+
+    static std::size_t index(MeasurementType type)
+    {
+        const auto i = static_cast<std::size_t>(type);
+        return i < s_numElementTypes ? i : static_cast<std::size_t>(MeasurementType::UNKNOWN);
+    };
+
+    std::array<Window, s_numElementTypes> m_windows{};
+};
+
+#endif // MEASUREMENTFILTER_HPP
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <charconv>
+#include <future>
+#include <thread>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "measurement.hpp"
+#include "measurementparser.hpp"
+#include "gzipreader.hpp"
+
+
+std::size_t
+MeasurementParser::parseCsv(std::string_view text, std::vector<Measurement>& measurements, const MeasurementFilter* filter)
+{
+    const std::size_t sizeBefore = measurements.size();
+    // Lines have about 30 characters. Reserving up front avoids most reallocations for large files.
+    measurements.reserve(sizeBefore + text.size() / 30);
+
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+        std::size_t eol = text.find('\n', pos);
+        if (eol == std::string_view::npos) {
+            eol = text.size();  // Last line without line break
+        }
+        parseCsvLine(text.substr(pos, eol - pos), measurements, filter);
+        pos = eol + 1;
+    }
+    return measurements.size() - sizeBefore;
+}
+
+
+MeasurementParser::Format
+MeasurementParser::formatForFilename(std::string_view filename)
+{
+    if (GzipReader::isGzipFilename(filename)) {
+        filename.remove_suffix(GzipReader::s_extension.size());
+    }
+    return filename.ends_with(s_dlyExtension) ? Format::DLY : Format::CSV;
+}
+
+
+std::size_t
+MeasurementParser::parseDly(std::string_view text, std::vector<Measurement>& measurements, const MeasurementFilter* filter)
+{
+    const std::size_t sizeBefore = measurements.size();
+    // 270 characters per line, of which typically more than 20 days hold a value.
+    measurements.reserve(sizeBefore + text.size() / 12);
+
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+        std::size_t eol = text.find('\n', pos);
+        if (eol == std::string_view::npos) {
+            eol = text.size();  // Last line without line break
+        }
+        parseDlyLine(text.substr(pos, eol - pos), measurements, filter);
+        pos = eol + 1;
+    }
+    return measurements.size() - sizeBefore;
+}
+
+
+std::size_t
+MeasurementParser::parseParallel(std::string_view text, std::vector<Measurement>& measurements, unsigned numChunks, Format format,
+                                 const MeasurementFilter* filter)
+{
+    if (numChunks <= 1) {
+        return parse(text, measurements, format, filter);
+    }
+
+    // One task per chunk, each filling its own vector.
+    std::vector<std::future<std::vector<Measurement>>> results;
+    for (std::string_view chunk : splitAtLineBreaks(text, numChunks)) {
+        results.push_back(std::async(std::launch::async, [chunk, format, filter]() {
+            std::vector<Measurement> chunkMeasurements;
+            parse(chunk, chunkMeasurements, format, filter);
+            return chunkMeasurements;
+        }));
+    }
+
+    // Concatenate in chunk order => same order as the sequential parse.
+    std::vector<std::vector<Measurement>> parts;
+    std::size_t total{0};
+    for (auto& result : results) {
+        parts.push_back(result.get());
+        total += parts.back().size();
+    }
+    const std::size_t sizeBefore = measurements.size();
+    measurements.reserve(sizeBefore + total);
+    for (const auto& part : parts) {
+        measurements.insert(measurements.end(), part.begin(), part.end());
+    }
+    return measurements.size() - sizeBefore;
+}
+
+
+bool
+MeasurementParser::parseGzip(const std::string& filename, std::vector<Measurement>& measurements, Format format,
+                             const MeasurementFilter* filter)
+{
+    return GzipReader::readLines(filename, [&measurements, format, filter](std::string_view text) {
+        parse(text, measurements, format, filter);
+    });
+}
+
+
+std::vector<std::string_view>
+MeasurementParser::splitAtLineBreaks(std::string_view text, unsigned numChunks)
+{
+    // Chunks of roughly equal size. Each chunk boundary is moved forward to the next line start.
+    std::vector<std::string_view> chunks;
+    const std::size_t chunkSize = text.size() / std::max(1u, numChunks);
+    std::size_t begin = 0;
+    for (unsigned i = 1; i < numChunks && begin < text.size(); ++i) {
+        std::size_t end = text.find('\n', std::max(begin, i * chunkSize));
+        if (end == std::string_view::npos) {
+            break;
+        }
+        ++end;  // Line break belongs to the chunk.
+        chunks.push_back(text.substr(begin, end - begin));
+        begin = end;
+    }
+    if (begin < text.size()) {
+        chunks.push_back(text.substr(begin));
+    }
+    return chunks;
+}
+
+
+unsigned
+MeasurementParser::chunkCountForSize(std::size_t textSize)
+{
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t bySize = std::max<std::size_t>(1, textSize / s_minChunkSize);
+    return static_cast<unsigned>(std::min<std::size_t>(cores, bySize));
+}
+
+
+bool
+MeasurementParser::parseCsvLine(std::string_view line, std::vector<Measurement>& measurements, const MeasurementFilter* filter)
+{
+    // Station ID (skipped)
+    std::size_t start = line.find(',');
+    if (start == std::string_view::npos) {
+        return false;
+    }
+    ++start;
+
+    // Date: exactly eight digits YYYYMMDD
+    std::size_t end = line.find(',', start);
+    if (end == std::string_view::npos || end - start != 8) {
+        return false;
+    }
+    const char* date = line.data() + start;
+    int year{0};
+    if (std::from_chars(date, date + 4, year).ptr != date + 4) {
+        return false;
+    }
+    start = end + 1;
+
+    // Element
+    end = line.find(',', start);
+    if (end == std::string_view::npos) {
+        return false;
+    }
+    const MeasurementType type = Measurement::typeFromString(line.substr(start, end - start));
+    start = end + 1;
+
+    // Push-down: a row not selected is dropped before month, day and value are decoded.
+    if (filter != nullptr && !filter->accepts(type, year)) {
+        return false;
+    }
+    int month{0};
+    int day{0};
+    if (std::from_chars(date + 4, date + 6, month).ptr != date + 6 ||
+        std::from_chars(date + 6, date + 8, day).ptr != date + 8 ||
+        month < 1 || month > 12 || day < 1 || day > 31) {
+        return false;
+    }
+
+    // Value. Terminated by comma, line break or end of line.
+    int value{0};
+    const char* first = line.data() + start;
+    const char* last = line.data() + line.size();
+    auto [ptr, ec] = std::from_chars(first, last, value);
+    if (ec != std::errc() || ptr == first) {
+        return false;
+    }
+
+    measurements.emplace_back(year, month, day, value, type);
+    return true;
+}
+
+
+bool
+MeasurementParser::parseDlyLine(std::string_view line, std::vector<Measurement>& measurements, const MeasurementFilter* filter)
+{
+    if (line.size() < s_dlyLineLength) {
+        return false;
+    }
+    const char* data = line.data();
+    int year{0};
+    int month{0};
+    if (std::from_chars(data + 11, data + 15, year).ptr != data + 15 ||
+        std::from_chars(data + 15, data + 17, month).ptr != data + 17 ||
+        month < 1 || month > 12) {
+        return false;
+    }
+    const MeasurementType type = Measurement::typeFromString(line.substr(17, 4));
+    if (type == MeasurementType::UNKNOWN) {
+        return false;  // Would be dropped by StationMeasurements anyway.
+    }
+    if (filter != nullptr && !filter->accepts(type, year)) {
+        return false;  // Whole station-month not selected
+    }
+
+    // Fixed offsets: VALUE of day d starts at s_dlyDaysOffset + d * s_dlySlotWidth, right aligned in 5 columns.
+    const char* slot = data + s_dlyDaysOffset;
+    for (int day = 1; day <= 31; ++day, slot += s_dlySlotWidth) {
+        const char* first = slot;
+        const char* last = slot + s_dlyValueWidth;
+        while (first < last && *first == ' ') {
+            ++first;
+        }
+        int value{0};
+        if (std::from_chars(first, last, value).ptr != last || value == s_dlyMissing) {
+            continue;  // Missing or malformed
+        }
+        measurements.emplace_back(year, month, day, value, type);
+    }
+    return true;
+}
@@ -0,0 +1,109 @@
+#ifndef MEASUREMENTPARSER_HPP
+#define MEASUREMENTPARSER_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "measurement.hpp"
+#include "measurementfilter.hpp"
+
+/*
+    Format of the per-station CSV files (one measurement per line):
+
+    ID,DATE,ELEMENT,DATA_VALUE,M_FLAG,Q_FLAG,S_FLAG,OBS_TIME
+
+    e. g.: GME00102380,19591201,TMAX,114,,,E,
+
+    Only DATE (YYYYMMDD), ELEMENT and DATA_VALUE are evaluated.
+
+
+    Format of the .dly files of ghcnd_all (one station-month per line, fixed width):
+
+    ------------------------------
+    Variable   Columns   Type
+    ------------------------------
+    ID            1-11   Character
+    YEAR         12-15   Integer
+    MONTH        16-17   Integer
+    ELEMENT      18-21   Character
+    VALUE1       22-26   Integer
+    MFLAG1       27-27   Character
+    QFLAG1       28-28   Character
+    SFLAG1       29-29   Character
+    VALUE2       30-34   Integer
+    ...
+    VALUE31     262-266  Integer
+    ...
+    SFLAG31     269-269  Character
+    ------------------------------
+
+    Missing values (including days 29-31 of shorter months) are -9999.
+*/
+
+class MeasurementParser
+{
+public:
+    enum class Format
+    {
+        CSV,
+        DLY
+    };
+
+    // Format by file name: .dly and .dly.gz are DLY, everything else is CSV.
+    static Format formatForFilename(std::string_view filename);
+
+    // Scans the complete text of a station file and appends one Measurement per valid line.
+    // Works directly on the given buffer: no per-line copies, no allocations besides the vector growth.
+    // Malformed lines are skipped. Returns the number of measurements appended.
+    // With a filter, element and year of a line are checked first and lines not selected are skipped
+    // before the rest of the line is decoded. nullptr selects everything (same for all functions below).
+    static std::size_t parseCsv(std::string_view text, std::vector<Measurement>& measurements,
+                                const MeasurementFilter* filter = nullptr);
+
+    // Same for the .dly layout: appends one Measurement per day slot that is not -9999, in date order
+    // within each line. Lines of unknown elements and malformed lines are skipped.
+    static std::size_t parseDly(std::string_view text, std::vector<Measurement>& measurements,
+                                const MeasurementFilter* filter = nullptr);
+
+    static std::size_t parse(std::string_view text, std::vector<Measurement>& measurements, Format format,
+                             const MeasurementFilter* filter = nullptr)
+    {
+        return format == Format::DLY ? parseDly(text, measurements, filter) : parseCsv(text, measurements, filter);
+    };
+
+    // Same result as parse(), but the text is split at line boundaries into numChunks chunks which are
+    // parsed concurrently and concatenated in their original order.
+    static std::size_t parseParallel(std::string_view text, std::vector<Measurement>& measurements, unsigned numChunks,
+                                     Format format = Format::CSV, const MeasurementFilter* filter = nullptr);
+
+    // Streams a gzip compressed station file through parse(). Decompression runs on a worker thread and
+    // overlaps with parsing (see GzipReader). Returns false if the file cannot be opened or is corrupt.
+    static bool parseGzip(const std::string& filename, std::vector<Measurement>& measurements, Format format = Format::CSV,
+                          const MeasurementFilter* filter = nullptr);
+
+    static constexpr std::string_view s_dlyExtension{".dly"};
+
+    // Splits text into at most numChunks pieces of similar size. Pieces end after a line break (the last one
+    // at the end of text), so every line lies completely within one piece.
+    static std::vector<std::string_view> splitAtLineBreaks(std::string_view text, unsigned numChunks);
+
+    // Number of chunks worth using for a text of the given size: one per core, but none smaller than s_minChunkSize.
+    static unsigned chunkCountForSize(std::size_t textSize);
+
+    static constexpr std::size_t s_minChunkSize{1 << 20};  // 1 MiB, about 30000 lines
+
+private:
+    static bool parseCsvLine(std::string_view line, std::vector<Measurement>& measurements, const MeasurementFilter* filter);
+
+    static bool parseDlyLine(std::string_view line, std::vector<Measurement>& measurements, const MeasurementFilter* filter);
+
+    static constexpr std::size_t s_dlyDaysOffset{21};  // Column of VALUE1 (zero based)
+    static constexpr std::size_t s_dlySlotWidth{8};    // VALUE, MFLAG, QFLAG, SFLAG
+    static constexpr std::size_t s_dlyValueWidth{5};
+    static constexpr std::size_t s_dlyLineLength{s_dlyDaysOffset + 31 * s_dlySlotWidth};
+    static constexpr int s_dlyMissing{-9999};
+};
+
+#endif // MEASUREMENTPARSER_HPP
@@ -0,0 +1,154 @@
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <utility>
+
+#include "stationkey.hpp"
+#include "stationmeasurements.hpp"
+#include "measurementfilter.hpp"
+#include "datacompleteness.hpp"
+#include "monthlyaggregates.hpp"
+#include "measurementscache.hpp"
+
+
+const StationMeasurements*
+MeasurementsCache::lookup(StationKey key, const MeasurementFilter& filter)
+{
+    auto found = m_index.find(key);
+    if (found == m_index.end() || found->second->measurements == nullptr || !found->second->coverage.covers(filter)) {
+        ++m_statistics.misses;
+        return nullptr;
+    }
+    ++m_statistics.hits;
+    m_entries.splice(m_entries.begin(), m_entries, found->second);  // Iterators stay valid
+    return found->second->measurements.get();
+}
+
+
+const MeasurementFilter*
+MeasurementsCache::coverage(StationKey key) const
+{
+    auto found = m_index.find(key);
+    return found == m_index.end() || found->second->measurements == nullptr ? nullptr : &found->second->coverage;
+}
+
+
+const StationMeasurements&
+MeasurementsCache::insert(StationKey key, std::unique_ptr<StationMeasurements> measurements, const MeasurementFilter& coverage)
+{
+    Entry& entry = touch(key);
+    entry.measurements = std::move(measurements);
+    entry.coverage = coverage;
+    if (!entry.aggregatesComplete) {
+        entry.aggregates.reset();  // Built from the replaced measurements
+    }
+    update(entry);
+    return *entry.measurements;
+}
+
+
+const DataCompleteness*
+MeasurementsCache::completeness(StationKey key)
+{
+    auto found = m_index.find(key);
+    if (found == m_index.end() || found->second->completeness == nullptr) {
+        return nullptr;
+    }
+    m_entries.splice(m_entries.begin(), m_entries, found->second);
+    return found->second->completeness.get();
+}
+
+
+const DataCompleteness&
+MeasurementsCache::insertCompleteness(StationKey key, std::unique_ptr<DataCompleteness> completeness)
+{
+    Entry& entry = touch(key);
+    entry.completeness = std::move(completeness);
+    update(entry);
+    return *entry.completeness;
+}
+
+
+const MonthlyAggregates*
+MeasurementsCache::aggregates(StationKey key, const MeasurementFilter& filter)
+{
+    auto found = m_index.find(key);
+    if (found == m_index.end() || found->second->aggregates == nullptr ||
+        !(found->second->aggregatesComplete || found->second->coverage.covers(filter))) {
+        return nullptr;
+    }
+    m_entries.splice(m_entries.begin(), m_entries, found->second);
+    return found->second->aggregates.get();
+}
+
+
+const MonthlyAggregates&
+MeasurementsCache::insertAggregates(StationKey key, std::unique_ptr<MonthlyAggregates> aggregates, bool complete)
+{
+    Entry& entry = touch(key);
+    entry.aggregates = std::move(aggregates);
+    entry.aggregatesComplete = complete;
+    update(entry);
+    return *entry.aggregates;
+}
+
+
+void
+MeasurementsCache::setByteBudget(std::size_t byteBudget)
+{
+    m_byteBudget = byteBudget;
+    evict();
+    m_statistics.entries = m_entries.size();
+}
+
+
+std::size_t
+MeasurementsCache::entryOverhead()
+{
+    // List node: Entry (with its MeasurementFilter) and two links. Hash node: key, iterator,
+    // next link and cached hash, plus one bucket pointer.
+    constexpr std::size_t listNode = sizeof(Entry) + 2 * sizeof(void*);
+    constexpr std::size_t hashNode = sizeof(std::pair<const StationKey, std::list<Entry>::iterator>) + 2 * sizeof(void*) + sizeof(void*);
+    return listNode + hashNode;
+}
+
+
+MeasurementsCache::Entry&
+MeasurementsCache::touch(StationKey key)
+{
+    if (auto found = m_index.find(key); found != m_index.end()) {
+        m_entries.splice(m_entries.begin(), m_entries, found->second);
+    } else {
+        m_entries.emplace_front(key);
+        m_index.emplace(key, m_entries.begin());
+    }
+    return m_entries.front();
+}
+
+
+void
+MeasurementsCache::update(Entry& entry)
+{
+    m_statistics.bytes -= entry.bytes;
+    entry.bytes = entryOverhead() +
+                  (entry.measurements != nullptr ? entry.measurements->memoryUsage() : 0) +
+                  (entry.completeness != nullptr ? entry.completeness->memoryUsage() : 0) +
+                  (entry.aggregates != nullptr ? entry.aggregates->memoryUsage() : 0);
+    m_statistics.bytes += entry.bytes;
+    evict();
+    m_statistics.entries = m_entries.size();
+}
+
+
+void
+MeasurementsCache::evict()
+{
+    // The front entry stays, even if it alone exceeds the budget (see class comment).
+    while (m_statistics.bytes > m_byteBudget && m_entries.size() > 1) {
+        const Entry& last = m_entries.back();
+        m_statistics.bytes -= last.bytes;
+        m_index.erase(last.key);
+        m_entries.pop_back();
+        ++m_statistics.evictions;
+    }
+}
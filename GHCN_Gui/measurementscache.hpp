@@ -0,0 +1,114 @@
+#ifndef MEASUREMENTSCACHE_HPP
+#define MEASUREMENTSCACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+#include "stationkey.hpp"
+#include "stationmeasurements.hpp"
+#include "measurementfilter.hpp"
+#include "datacompleteness.hpp"
+#include "monthlyaggregates.hpp"
+
+/*
+    Measurements, completeness bitmaps and monthly aggregates of recently used stations, bounded
+    by a byte budget.
+
+    A station has one entry for all three, each part may be missing. Every entry is charged with
+    the memoryUsage() of its parts, i. e. the capacity of their vectors, plus entryOverhead() for
+    the coverage and the list and hash nodes. Inserting beyond the budget evicts the least
+    recently used stations first, with all their parts.
+
+    The station just inserted is never evicted: insert() returns it to be used. A single station
+    larger than the budget therefore stays cached, and the cache stays over budget, until the
+    next insert or setByteBudget() evicts it.
+
+    A lookup is a hit if the station is cached with a selection that covers the requested one.
+    Hits, misses and evictions are counted to size the budget. Summaries are looked up without
+    counting, but like a hit they make the station the most recently used one.
+*/
+class MeasurementsCache
+{
+public:
+    struct Statistics
+    {
+        std::uint64_t hits{0};
+        std::uint64_t misses{0};
+        std::uint64_t evictions{0};
+        std::size_t entries{0};
+        std::size_t bytes{0};
+    };
+
+    explicit MeasurementsCache(std::size_t byteBudget = s_defaultByteBudget) : m_byteBudget(byteBudget) {};
+
+    // Measurements of the station if they cover filter, nullptr otherwise. Counts a hit or a miss,
+    // a hit makes the station the most recently used one.
+    const StationMeasurements* lookup(StationKey key, const MeasurementFilter& filter);
+
+    // Selection the measurements of the station are cached with, nullptr if none are cached. Not counted.
+    const MeasurementFilter* coverage(StationKey key) const;
+
+    // Replaces the measurements of the station, then evicts least recently used stations until the budget
+    // is met. Aggregates built from the replaced measurements are dropped.
+    const StationMeasurements& insert(StationKey key, std::unique_ptr<StationMeasurements> measurements, const MeasurementFilter& coverage);
+
+    // Measurements of a cached station (e. g. right after insert()). Not counted.
+    const StationMeasurements& at(StationKey key) const {return *m_index.at(key)->measurements;};
+
+    // Completeness bitmaps of the station, nullptr if not cached. Always built from all measurements.
+    const DataCompleteness* completeness(StationKey key);
+
+    const DataCompleteness& insertCompleteness(StationKey key, std::unique_ptr<DataCompleteness> completeness);
+
+    // Monthly aggregates of the station if they were built from all measurements or from measurements
+    // that cover filter, nullptr otherwise.
+    const MonthlyAggregates* aggregates(StationKey key, const MeasurementFilter& filter);
+
+    // complete: built from all measurements (e. g. read from the sidecar). Otherwise the aggregates must be
+    // built from the measurements cached for the station, and they are dropped with them.
+    const MonthlyAggregates& insertAggregates(StationKey key, std::unique_ptr<MonthlyAggregates> aggregates, bool complete);
+
+    // Evicts at once if the cache is larger than the new budget.
+    void setByteBudget(std::size_t byteBudget);
+
+    std::size_t byteBudget() const {return m_byteBudget;};
+
+    const Statistics& statistics() const {return m_statistics;};
+
+    // Bytes charged per entry in addition to its parts.
+    static std::size_t entryOverhead();
+
+    static constexpr std::size_t s_defaultByteBudget{256 * 1024 * 1024};
+
+private:
+    struct Entry
+    {
+        explicit Entry(StationKey stationKey) : key(stationKey) {};
+
+        StationKey key;
+        std::unique_ptr<StationMeasurements> measurements;
+        MeasurementFilter coverage;  // Of measurements
+        std::unique_ptr<DataCompleteness> completeness;
+        std::unique_ptr<MonthlyAggregates> aggregates;
+        bool aggregatesComplete{false};
+        std::size_t bytes{0};
+    };
+
+    // Entry of the station as the most recently used one, created empty if there is none.
+    Entry& touch(StationKey key);
+
+    // Charges the entry with its current parts, then evicts least recently used stations.
+    void update(Entry& entry);
+
+    void evict();
+
+    std::size_t m_byteBudget;
+    std::list<Entry> m_entries;  // Most recently used first
+    std::unordered_map<StationKey, std::list<Entry>::iterator> m_index;
+    Statistics m_statistics;
+};
+
+#endif // MEASUREMENTSCACHE_HPP
@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "stationkey.hpp"
+#include "stationmetadata.hpp"
+#include "spatialindex.hpp"
+#include "mappedfile.hpp"
+#include "metadatasnapshot.hpp"
+
+
+// Copies count elements at offset into target. False if the section exceeds the data.
+template<typename Container>
+static bool
+loadSection(std::string_view data, std::uint64_t offset, std::uint64_t count, Container& target)
+{
+    using T = typename Container::value_type;
+    if (offset > data.size() || count > (data.size() - offset) / sizeof(T)) {
+        return false;  // Truncated
+    }
+    target.resize(count);
+    std::memcpy(target.data(), data.data() + offset, count * sizeof(T));
+    return true;
+}
+
+
+bool
+MetadataSnapshot::read(const std::string& snapshotFilename, const std::string& stationsFilename, const std::string& inventoryFilename,
+                       StationMetadata& metadata)
+{
+    MappedFile mappedFile(snapshotFilename);
+    if (!mappedFile.isValid()) {
+        return false;  // No snapshot yet
+    }
+    const std::string_view data = mappedFile.view();
+    if (data.size() < sizeof(Header)) {
+        return false;
+    }
+    Header header;
+    std::memcpy(&header, data.data(), sizeof(Header));
+    if (std::memcmp(header.magic, s_magic, sizeof(s_magic)) != 0 ||
+        header.version != s_version ||
+        header.byteOrder != s_byteOrder) {
+        return false;
+    }
+
+    // Snapshot must belong to the current state of both source files.
+    Header sources;
+    if (!describeSources(stationsFilename, inventoryFilename, sources) ||
+        sources.stationsSize != header.stationsSize ||
+        sources.stationsMtime != header.stationsMtime ||
+        sources.inventorySize != header.inventorySize ||
+        sources.inventoryMtime != header.inventoryMtime) {
+        return false;
+    }
+
+    // Loaded into a fresh object: metadata stays untouched if the snapshot turns out to be broken.
+    StationMetadata loaded;
+    if (!loadSection(data, header.offsets[KEYS], header.counts[KEYS], loaded.m_keys) ||
+        !loadSection(data, header.offsets[LATITUDES], header.counts[LATITUDES], loaded.m_latitudes) ||
+        !loadSection(data, header.offsets[LONGITUDES], header.counts[LONGITUDES], loaded.m_longitudes) ||
+        !loadSection(data, header.offsets[ELEVATIONS], header.counts[ELEVATIONS], loaded.m_elevations) ||
+        !loadSection(data, header.offsets[LATITUDE_RADIANS], header.counts[LATITUDE_RADIANS], loaded.m_latitudeRadians) ||
+        !loadSection(data, header.offsets[LONGITUDE_RADIANS], header.counts[LONGITUDE_RADIANS], loaded.m_longitudeRadians) ||
+        !loadSection(data, header.offsets[COS_LATITUDES], header.counts[COS_LATITUDES], loaded.m_cosLatitudes) ||
+        !loadSection(data, header.offsets[NAME_OFFSETS], header.counts[NAME_OFFSETS], loaded.m_nameOffsets) ||
+        !loadSection(data, header.offsets[NAMES], header.counts[NAMES], loaded.m_names) ||
+        !loadSection(data, header.offsets[INVENTORY], header.counts[INVENTORY], loaded.m_inventory) ||
+        !loadSection(data, header.offsets[INVENTORY_INDEX], header.counts[INVENTORY_INDEX], loaded.m_inventoryIndex) ||
+        !loadSection(data, header.offsets[SPATIAL_X], header.counts[SPATIAL_X], loaded.m_spatialIndex.m_x) ||
+        !loadSection(data, header.offsets[SPATIAL_Y], header.counts[SPATIAL_Y], loaded.m_spatialIndex.m_y) ||
+        !loadSection(data, header.offsets[SPATIAL_Z], header.counts[SPATIAL_Z], loaded.m_spatialIndex.m_z) ||
+        !loadSection(data, header.offsets[SPATIAL_INDICES], header.counts[SPATIAL_INDICES], loaded.m_spatialIndex.m_indices) ||
+        !loadSection(data, header.offsets[SPATIAL_NODES], header.counts[SPATIAL_NODES], loaded.m_spatialIndex.m_nodes)) {
+        return false;
+    }
+
+    // Consistency, so lookups cannot run out of bounds or probe forever.
+    const std::size_t stationCount = loaded.m_keys.size();
+    if (loaded.m_latitudes.size() != stationCount ||
+        loaded.m_longitudes.size() != stationCount ||
+        loaded.m_elevations.size() != stationCount ||
+        loaded.m_latitudeRadians.size() != stationCount ||
+        loaded.m_longitudeRadians.size() != stationCount ||
+        loaded.m_cosLatitudes.size() != stationCount ||
+        loaded.m_nameOffsets.size() != stationCount + 1 ||
+        loaded.m_nameOffsets.front() != 0 ||
+        loaded.m_nameOffsets.back() != loaded.m_names.size() ||
+        !std::ranges::is_sorted(loaded.m_nameOffsets)) {
+        return false;
+    }
+    const auto& index = loaded.m_inventoryIndex;
+    std::size_t usedSlots{0};
+    for (const auto& slot : index) {
+        if (slot.key.isValid()) {
+            if (slot.first > loaded.m_inventory.size() || slot.count > loaded.m_inventory.size() - slot.first) {
+                return false;
+            }
+            ++usedSlots;
+        }
+    }
+    if (!std::has_single_bit(index.size()) || 2 * usedSlots > index.size()) {
+        return false;
+    }
+    const SpatialIndex& spatialIndex = loaded.m_spatialIndex;
+    if (spatialIndex.m_x.size() != stationCount ||
+        spatialIndex.m_y.size() != stationCount ||
+        spatialIndex.m_z.size() != stationCount ||
+        spatialIndex.m_indices.size() != stationCount ||
+        spatialIndex.m_nodes.size() != SpatialIndex::nodeCount(stationCount) ||
+        !std::ranges::all_of(spatialIndex.m_indices, [stationCount](std::uint32_t index) {return index < stationCount;}) ||
+        !std::ranges::all_of(spatialIndex.m_nodes, [](const auto& node) {return node.axis < 3;})) {
+        return false;
+    }
+
+    metadata = std::move(loaded);
+    return true;
+}
+
+
+bool
+MetadataSnapshot::write(const std::string& snapshotFilename, const std::string& stationsFilename, const std::string& inventoryFilename,
+                        const StationMetadata& metadata)
+{
+    Header header{};
+    std::memcpy(header.magic, s_magic, sizeof(s_magic));
+    header.version = s_version;
+    header.byteOrder = s_byteOrder;
+    if (!describeSources(stationsFilename, inventoryFilename, header)) {
+        return false;
+    }
+
+    struct Source
+    {
+        const void* data;
+        std::uint64_t count;
+        std::uint64_t elementSize;
+    };
+    const Source sources[NUM_SECTIONS] = {
+        {metadata.m_keys.data(), metadata.m_keys.size(), sizeof(StationKey)},
+        {metadata.m_latitudes.data(), metadata.m_latitudes.size(), sizeof(double)},
+        {metadata.m_longitudes.data(), metadata.m_longitudes.size(), sizeof(double)},
+        {metadata.m_elevations.data(), metadata.m_elevations.size(), sizeof(double)},
+        {metadata.m_latitudeRadians.data(), metadata.m_latitudeRadians.size(), sizeof(double)},
+        {metadata.m_longitudeRadians.data(), metadata.m_longitudeRadians.size(), sizeof(double)},
+        {metadata.m_cosLatitudes.data(), metadata.m_cosLatitudes.size(), sizeof(double)},
+        {metadata.m_nameOffsets.data(), metadata.m_nameOffsets.size(), sizeof(std::uint32_t)},
+        {metadata.m_names.data(), metadata.m_names.size(), sizeof(char)},
+        {metadata.m_inventory.data(), metadata.m_inventory.size(), sizeof(StationMetadata::InventoryEntry)},
+        {metadata.m_inventoryIndex.data(), metadata.m_inventoryIndex.size(), sizeof(StationMetadata::IndexSlot)},
+        {metadata.m_spatialIndex.m_x.data(), metadata.m_spatialIndex.m_x.size(), sizeof(double)},
+        {metadata.m_spatialIndex.m_y.data(), metadata.m_spatialIndex.m_y.size(), sizeof(double)},
+        {metadata.m_spatialIndex.m_z.data(), metadata.m_spatialIndex.m_z.size(), sizeof(double)},
+        {metadata.m_spatialIndex.m_indices.data(), metadata.m_spatialIndex.m_indices.size(), sizeof(std::uint32_t)},
+        {metadata.m_spatialIndex.m_nodes.data(), metadata.m_spatialIndex.m_nodes.size(), sizeof(SpatialIndex::Node)},
+    };
+    std::uint64_t fileSize = alignUp(sizeof(Header));
+    for (int section = 0; section < NUM_SECTIONS; ++section) {
+        header.offsets[section] = fileSize;
+        header.counts[section] = sources[section].count;
+        fileSize = alignUp(fileSize + sources[section].count * sources[section].elementSize);
+    }
+
+    // Build the complete image in memory and write it with a single call.
+    std::vector<char> image(fileSize, 0);
+    std::memcpy(image.data(), &header, sizeof(Header));
+    for (int section = 0; section < NUM_SECTIONS; ++section) {
+        if (sources[section].count > 0) {
+            std::memcpy(image.data() + header.offsets[section], sources[section].data, sources[section].count * sources[section].elementSize);
+        }
+    }
+
+    const std::string tmpFilename = snapshotFilename + ".tmp";
+    std::error_code ec;
+    {
+        std::ofstream outStream{tmpFilename, std::ios::out | std::ios::binary | std::ios::trunc};
+        if (!outStream) {
+            return false;  // e. g. read-only data directory
+        }
+        outStream.write(image.data(), static_cast<std::streamsize>(image.size()));
+        if (!outStream) {
+            outStream.close();
+            std::filesystem::remove(tmpFilename, ec);  // Best effort, the write has failed anyway
+            return false;
+        }
+    }
+    std::filesystem::rename(tmpFilename, snapshotFilename, ec);
+    if (ec) {
+        std::filesystem::remove(tmpFilename, ec);
+        return false;
+    }
+    return true;
+}
+
+
+std::string
+MetadataSnapshot::snapshotFilenameFor(const std::string& stationsFilename)
+{
+    return std::filesystem::path(stationsFilename).replace_extension(".ghcnmeta").string();
+}
+
+
+bool
+MetadataSnapshot::describeSources(const std::string& stationsFilename, const std::string& inventoryFilename, Header& header)
+{
+    std::error_code ec;
+    header.stationsSize = std::filesystem::file_size(stationsFilename, ec);
+    if (ec) {
+        return false;
+    }
+    header.stationsMtime = static_cast<std::int64_t>(std::filesystem::last_write_time(stationsFilename, ec).time_since_epoch().count());
+    if (ec) {
+        return false;
+    }
+    header.inventorySize = std::filesystem::file_size(inventoryFilename, ec);
+    if (ec) {
+        return false;
+    }
+    header.inventoryMtime = static_cast<std::int64_t>(std::filesystem::last_write_time(inventoryFilename, ec).time_since_epoch().count());
+    return !ec;
+}
@@ -0,0 +1,82 @@
+#ifndef METADATASNAPSHOT_HPP
+#define METADATASNAPSHOT_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "stationmetadata.hpp"
+
+/*
+    Binary snapshot of the stations and inventory files (e. g. ghcnd-stations.ghcnmeta next to
+    ghcnd-stations.txt), so a launch does not have to parse them again.
+
+    Layout (native byte order, all offsets relative to file start and 8 byte aligned):
+
+    Header
+    one section per array of StationMetadata and its SpatialIndex, in the order of Section below
+
+    The header stores size and modification time of both source files. A snapshot whose sources
+    have changed is rejected and rewritten after the next parse.
+    Increment s_version whenever the layout, StationKey, SpatialIndex or MeasurementType changes.
+*/
+
+class MetadataSnapshot
+{
+public:
+    // Loads metadata from snapshotFilename if it is valid for the source files. Returns false otherwise.
+    static bool read(const std::string& snapshotFilename, const std::string& stationsFilename, const std::string& inventoryFilename,
+                     StationMetadata& metadata);
+
+    // Writes the snapshot (via a temporary file, so readers never see a partial file). Returns false on failure.
+    static bool write(const std::string& snapshotFilename, const std::string& stationsFilename, const std::string& inventoryFilename,
+                      const StationMetadata& metadata);
+
+    // Stations file with extension replaced by .ghcnmeta.
+    static std::string snapshotFilenameFor(const std::string& stationsFilename);
+
+private:
+    enum Section
+    {
+        KEYS,
+        LATITUDES,
+        LONGITUDES,
+        ELEVATIONS,
+        LATITUDE_RADIANS,
+        LONGITUDE_RADIANS,
+        COS_LATITUDES,
+        NAME_OFFSETS,
+        NAMES,
+        INVENTORY,
+        INVENTORY_INDEX,
+        SPATIAL_X,
+        SPATIAL_Y,
+        SPATIAL_Z,
+        SPATIAL_INDICES,
+        SPATIAL_NODES,
+        NUM_SECTIONS
+    };
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byteOrder;
+        std::uint64_t stationsSize;
+        std::int64_t stationsMtime;
+        std::uint64_t inventorySize;
+        std::int64_t inventoryMtime;
+        std::uint64_t offsets[NUM_SECTIONS];
+        std::uint64_t counts[NUM_SECTIONS];  // Elements, not bytes
+    };
+
+    static constexpr char s_magic[8] = {'G', 'H', 'C', 'N', 'M', 'E', 'T', 'A'};
+    static constexpr std::uint32_t s_version{3};
+    static constexpr std::uint32_t s_byteOrder{0x01020304};
+
+    // Fills size and mtime of the source files. Returns false if one is not accessible.
+    static bool describeSources(const std::string& stationsFilename, const std::string& inventoryFilename, Header& header);
+
+    static std::uint64_t alignUp(std::uint64_t offset) {return (offset + 7) & ~std::uint64_t{7};};
+};
+
+#endif // METADATASNAPSHOT_HPP
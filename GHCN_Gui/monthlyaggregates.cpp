@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "measurement.hpp"
+#include "stationmeasurements.hpp"
+#include "yearseries.hpp"
+#include "monthlyaggregates.hpp"
+
+
+MonthlyAggregates::MonthlyAggregates(const StationMeasurements& measurements)
+{
+    for (std::size_t typeIndex = 0; typeIndex < StationMeasurements::s_numTypes; ++typeIndex) {
+        const auto type = static_cast<MeasurementType>(typeIndex);
+        const auto series = measurements.series(type);
+        if (series.empty()) {
+            continue;
+        }
+        const int firstYear = measurements.firstYear(type);
+        const int lastYear = measurements.lastYear(type);
+        const YearSeries entry{static_cast<std::uint32_t>(typeIndex), firstYear, static_cast<std::uint32_t>(lastYear - firstYear + 1),
+                           static_cast<std::uint32_t>(m_sums.size())};
+        const std::size_t numMonths = static_cast<std::size_t>(entry.yearCount) * 12;
+
+        // Totals per month first, then running totals in place.
+        m_sums.resize(m_sums.size() + numMonths + 1, 0);
+        m_counts.resize(m_counts.size() + numMonths + 1, 0);
+        std::int64_t* sums = m_sums.data() + entry.first;
+        std::uint32_t* counts = m_counts.data() + entry.first;
+        for (const Measurement& m : series) {
+            const std::size_t month = static_cast<std::size_t>(m.getYear() - firstYear) * 12 + static_cast<std::size_t>(m.getMonth() - 1);
+            sums[month + 1] += m.getValue();
+            ++counts[month + 1];
+        }
+        for (std::size_t i = 1; i <= numMonths; ++i) {
+            sums[i] += sums[i - 1];
+            counts[i] += counts[i - 1];
+        }
+        m_series.push_back(entry);
+    }
+}
+
+
+MonthlyAggregates::Total
+MonthlyAggregates::total(MeasurementType type, int startYear, int startMonth, int endYear, int endMonth) const
+{
+    const YearSeries* series = YearSeries::find(m_series, type);
+    if (series == nullptr) {
+        return Total{};
+    }
+    const long numMonths = static_cast<long>(series->yearCount) * 12;
+    auto slot = [series](int year, int month) {return (static_cast<long>(year) - series->firstYear) * 12 + (month - 1);};
+    const long first = std::clamp(slot(startYear, startMonth), 0L, numMonths);
+    const long last = std::clamp(slot(endYear, endMonth) + 1, 0L, numMonths);  // exclusive
+    if (first >= last) {
+        return Total{};
+    }
+    const std::size_t begin = series->first + static_cast<std::size_t>(first);
+    const std::size_t end = series->first + static_cast<std::size_t>(last);
+    return Total{m_sums[end] - m_sums[begin], m_counts[end] - m_counts[begin]};
+}
+
+
+int
+MonthlyAggregates::firstYear(MeasurementType type) const
+{
+    const YearSeries* series = YearSeries::find(m_series, type);
+    return series != nullptr ? series->firstYear : 1;
+}
+
+
+int
+MonthlyAggregates::lastYear(MeasurementType type) const
+{
+    const YearSeries* series = YearSeries::find(m_series, type);
+    return series != nullptr ? series->lastYear() : 0;
+}
+
+
+std::size_t
+MonthlyAggregates::memoryUsage() const
+{
+    return sizeof(MonthlyAggregates) + m_series.capacity() * sizeof(YearSeries) +
+           m_sums.capacity() * sizeof(std::int64_t) + m_counts.capacity() * sizeof(std::uint32_t);
+}
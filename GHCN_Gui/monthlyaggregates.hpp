@@ -0,0 +1,57 @@
+#ifndef MONTHLYAGGREGATES_HPP
+#define MONTHLYAGGREGATES_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "measurement.hpp"
+#include "stationmeasurements.hpp"
+#include "yearseries.hpp"
+
+/*
+    Sums and counts of the measurement values of a station per element and month.
+
+    Yearly, seasonal and monthly averages only need the sum and the number of values of a
+    window. Both are kept as running totals over the months of an element, from its first to its
+    last year, so any year or month window is two subtractions, like StationMeasurements::range().
+
+    The totals are built with the binary sidecar and stored in it (see BinaryCache), so a station
+    viewed before is averaged without its measurements.
+*/
+class MonthlyAggregates
+{
+public:
+    struct Total
+    {
+        std::int64_t sum{0};
+        std::uint32_t count{0};
+
+        bool empty() const {return count == 0;};
+    };
+
+    MonthlyAggregates() = default;
+
+    explicit MonthlyAggregates(const StationMeasurements& measurements);
+
+    // Values of the type from startMonth/startYear to endMonth/endYear (both inclusive), clamped to the
+    // years available for the type.
+    Total total(MeasurementType type, int startYear, int startMonth, int endYear, int endMonth) const;
+
+    // First and last year with measurements of the given type. firstYear() > lastYear() if there are none.
+    int firstYear(MeasurementType type) const;
+    int lastYear(MeasurementType type) const;
+
+    // Bytes allocated by this object, including unused vector capacity.
+    std::size_t memoryUsage() const;
+
+private:
+    friend class BinaryCache;
+
+    // Ascending by type, first: yearCount * 12 + 1 running totals from here, the first one is 0
+    std::vector<YearSeries> m_series;
+    std::vector<std::int64_t> m_sums;
+    std::vector<std::uint32_t> m_counts;
+};
+
+#endif // MONTHLYAGGREGATES_HPP
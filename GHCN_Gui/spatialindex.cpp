@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <numbers>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "distancekernel.hpp"
+#include "spatialindex.hpp"
+
+
+void
+SpatialIndex::toUnitVector(double latitude, double longitude, double* coords)
+{
+    const double lat = latitude * std::numbers::pi_v<double> / 180;
+    const double lng = longitude * std::numbers::pi_v<double> / 180;
+    coords[0] = std::cos(lat) * std::cos(lng);
+    coords[1] = std::cos(lat) * std::sin(lng);
+    coords[2] = std::sin(lat);
+}
+
+
+SpatialIndex::SpatialIndex(std::span<const double> latitudes, std::span<const double> longitudes)
+{
+    const std::size_t count = std::min(latitudes.size(), longitudes.size());
+    m_x.resize(count);
+    m_y.resize(count);
+    m_z.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        double coords[3];
+        toUnitVector(latitudes[i], longitudes[i], coords);
+        m_x[i] = coords[0];
+        m_y[i] = coords[1];
+        m_z[i] = coords[2];
+    }
+    // Build on a permutation, then bring the columns into tree order once.
+    std::vector<std::uint32_t> order(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        order[i] = static_cast<std::uint32_t>(i);
+    }
+    m_nodes.resize(nodeCount(count));
+    build(0, 0, count, order);
+
+    std::vector<double> x(count);
+    std::vector<double> y(count);
+    std::vector<double> z(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        x[i] = m_x[order[i]];
+        y[i] = m_y[order[i]];
+        z[i] = m_z[order[i]];
+    }
+    m_x = std::move(x);
+    m_y = std::move(y);
+    m_z = std::move(z);
+    m_indices = std::move(order);
+}
+
+
+void
+SpatialIndex::build(std::size_t node, std::size_t first, std::size_t last, std::vector<std::uint32_t>& order)
+{
+    if (last - first <= s_leafSize) {
+        return;
+    }
+    const std::vector<double>* columns[3] = {&m_x, &m_y, &m_z};
+    // Split along the axis of largest extent, so cells stay compact on the sphere.
+    double low[3] = {2, 2, 2};
+    double high[3] = {-2, -2, -2};
+    for (std::size_t i = first; i < last; ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            low[axis] = std::min(low[axis], (*columns[axis])[order[i]]);
+            high[axis] = std::max(high[axis], (*columns[axis])[order[i]]);
+        }
+    }
+    std::uint8_t axis{0};
+    for (std::uint8_t a = 1; a < 3; ++a) {
+        if (high[a] - low[a] > high[axis] - low[axis]) {
+            axis = a;
+        }
+    }
+    const std::vector<double>& column = *columns[axis];
+    const std::size_t mid = first + (last - first) / 2;
+    std::nth_element(order.begin() + first, order.begin() + mid, order.begin() + last,
+                     [&column](std::uint32_t i1, std::uint32_t i2) {return column[i1] < column[i2];});
+    m_nodes[node] = Node{column[order[mid]], axis};
+    build(2 * node + 1, first, mid, order);
+    build(2 * node + 2, mid, last, order);
+}
+
+
+std::size_t
+SpatialIndex::nodeCount(std::size_t count)
+{
+    // Highest node number of the recursion in build() plus one.
+    auto highestNode = [](auto& self, std::size_t node, std::size_t size) -> std::size_t {
+        if (size <= s_leafSize) {
+            return 0;
+        }
+        return std::max({node + 1, self(self, 2 * node + 1, size / 2), self(self, 2 * node + 2, size - size / 2)});
+    };
+    return highestNode(highestNode, 0, count);
+}
+
+
+SpatialIndex::Query
+SpatialIndex::makeQuery(double latitude, double longitude, double radius)
+{
+    Query query;
+    toUnitVector(latitude, longitude, query.coords);
+    const double angle = std::max(0.0, radius) / s_earthRadius;
+    if (angle >= std::numbers::pi_v<double>) {
+        query.maxDistance2 = 4.0 + 1e-9;  // Whole sphere
+    } else {
+        const double chord = 2 * std::sin(angle / 2);
+        query.maxDistance2 = chord * chord * (1 + 1e-9) + 1e-15;  // Tolerance for rounding errors
+    }
+    return query;
+}
+
+
+std::vector<std::uint32_t>
+SpatialIndex::withinRadius(double latitude, double longitude, double radius) const
+{
+    std::vector<std::uint32_t> result;
+    searchRadius(0, 0, m_indices.size(), makeQuery(latitude, longitude, radius), result);
+    return result;
+}
+
+
+void
+SpatialIndex::searchRadius(std::size_t node, std::size_t first, std::size_t last, const Query& query, std::vector<std::uint32_t>& result) const
+{
+    if (last - first <= s_leafSize) {
+        DistanceKernel::selectWithin(m_x.data() + first, m_y.data() + first, m_z.data() + first, m_indices.data() + first,
+                                     last - first, query.coords, query.maxDistance2, result);
+        return;
+    }
+    const std::size_t mid = first + (last - first) / 2;
+    const Node& split = m_nodes[node];
+    // Points on the far side are at least |diff| away along the split axis.
+    const double diff = query.coords[split.axis] - split.split;
+    const bool farSideReached = diff * diff <= query.maxDistance2;
+    if (diff < 0) {
+        searchRadius(2 * node + 1, first, mid, query, result);
+        if (farSideReached) {
+            searchRadius(2 * node + 2, mid, last, query, result);
+        }
+    } else {
+        searchRadius(2 * node + 2, mid, last, query, result);
+        if (farSideReached) {
+            searchRadius(2 * node + 1, first, mid, query, result);
+        }
+    }
+}
+
+
+std::vector<std::uint32_t>
+SpatialIndex::nearest(double latitude, double longitude, std::size_t k, double maxRadius) const
+{
+    return nearest(latitude, longitude, k, maxRadius, {});
+}
+
+
+std::vector<std::uint32_t>
+SpatialIndex::nearest(double latitude, double longitude, std::size_t k, double maxRadius,
+                      const std::function<bool(std::uint32_t)>& accept) const
+{
+    std::vector<std::uint32_t> result;
+    if (k == 0) {
+        return result;
+    }
+    Query query = makeQuery(latitude, longitude, maxRadius);
+    std::vector<std::pair<double, std::uint32_t>> heap;
+    heap.reserve(k + 1);
+    searchNearest(0, 0, m_indices.size(), query, k, accept, heap);
+    std::ranges::sort_heap(heap);
+    result.reserve(heap.size());
+    for (const auto& [distance2, index] : heap) {
+        result.push_back(index);
+    }
+    return result;
+}
+
+
+void
+SpatialIndex::searchNearest(std::size_t node, std::size_t first, std::size_t last, Query& query, std::size_t k,
+                            const std::function<bool(std::uint32_t)>& accept, std::vector<std::pair<double, std::uint32_t>>& heap) const
+{
+    if (last - first <= s_leafSize) {
+        double distances[s_leafSize];
+        DistanceKernel::squaredDistances(m_x.data() + first, m_y.data() + first, m_z.data() + first, last - first,
+                                         query.coords, distances);
+        for (std::size_t i = 0; i < last - first; ++i) {
+            // Distance first: the predicate may be far more expensive.
+            if (distances[i] > query.maxDistance2 || (accept && !accept(m_indices[first + i]))) {
+                continue;
+            }
+            heap.emplace_back(distances[i], m_indices[first + i]);
+            std::ranges::push_heap(heap);
+            if (heap.size() > k) {
+                std::ranges::pop_heap(heap);
+                heap.pop_back();
+            }
+            if (heap.size() == k) {
+                query.maxDistance2 = heap.front().first;  // Only closer points can enter from now on
+            }
+        }
+        return;
+    }
+    // Near side first, it tightens the bound for the far side.
+    const std::size_t mid = first + (last - first) / 2;
+    const Node& split = m_nodes[node];
+    const double diff = query.coords[split.axis] - split.split;
+    if (diff < 0) {
+        searchNearest(2 * node + 1, first, mid, query, k, accept, heap);
+        if (diff * diff <= query.maxDistance2) {
+            searchNearest(2 * node + 2, mid, last, query, k, accept, heap);
+        }
+    } else {
+        searchNearest(2 * node + 2, mid, last, query, k, accept, heap);
+        if (diff * diff <= query.maxDistance2) {
+            searchNearest(2 * node + 1, first, mid, query, k, accept, heap);
+        }
+    }
+}
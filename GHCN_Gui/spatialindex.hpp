@@ -0,0 +1,92 @@
+#ifndef SPATIALINDEX_HPP
+#define SPATIALINDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <utility>
+#include <vector>
+
+/*
+    k-d tree over station locations as 3D unit vectors.
+
+    On the unit sphere the straight-line (chord) distance grows monotonically with the
+    great-circle distance, so a radius on the surface becomes a ball in 3D: no special cases
+    at the poles or the date line.
+
+    The tree is implicit. Points are reordered so that each inner node splits its range at the
+    middle, along the axis of largest extent. Inner nodes are numbered like a binary heap
+    (children of node n are 2n + 1 and 2n + 2). Ranges of at most s_leafSize points are leaves.
+    Coordinates are stored column-wise in tree order, so a leaf is scanned with DistanceKernel
+    in one batch.
+
+    Queries return point indices (positions in the arrays the index was built from). Bounds are
+    widened by a small tolerance, callers that need an exact radius check their own distance.
+*/
+class SpatialIndex
+{
+public:
+    SpatialIndex() = default;
+
+    // Latitudes and longitudes in degrees, same size.
+    SpatialIndex(std::span<const double> latitudes, std::span<const double> longitudes);
+
+    // All points within radius (km) of the location, in no particular order. May contain points a
+    // rounding error beyond the radius.
+    std::vector<std::uint32_t> withinRadius(double latitude, double longitude, double radius) const;
+
+    // Up to k points nearest to the location and within maxRadius (km), nearest first.
+    std::vector<std::uint32_t> nearest(double latitude, double longitude, std::size_t k, double maxRadius) const;
+
+    // Same, counting only points accept returns true for. accept is called for points that are
+    // closer than the k nearest accepted so far, not for every point within maxRadius.
+    std::vector<std::uint32_t> nearest(double latitude, double longitude, std::size_t k, double maxRadius,
+                                       const std::function<bool(std::uint32_t)>& accept) const;
+
+    std::size_t size() const {return m_indices.size();};
+
+    // Unit vector for a location in degrees.
+    static void toUnitVector(double latitude, double longitude, double* coords);
+
+    // Inner nodes of a tree over count points (size of m_nodes).
+    static std::size_t nodeCount(std::size_t count);
+
+    static constexpr double s_earthRadius{6378.388};  // km, as used for haversine distances
+    static constexpr std::size_t s_leafSize{32};
+
+private:
+    friend class MetadataSnapshot;
+
+    struct Node
+    {
+        double split;  // Points before the middle are <= split, from the middle on >= split
+        std::uint8_t axis;
+    };
+
+    struct Query
+    {
+        double coords[3];
+        double maxDistance2;  // Squared chord length
+    };
+
+    void build(std::size_t node, std::size_t first, std::size_t last, std::vector<std::uint32_t>& order);
+
+    void searchRadius(std::size_t node, std::size_t first, std::size_t last, const Query& query, std::vector<std::uint32_t>& result) const;
+
+    // Max-heap of (squared distance, index), at most k entries.
+    void searchNearest(std::size_t node, std::size_t first, std::size_t last, Query& query, std::size_t k,
+                       const std::function<bool(std::uint32_t)>& accept, std::vector<std::pair<double, std::uint32_t>>& heap) const;
+
+    static Query makeQuery(double latitude, double longitude, double radius);
+
+    // Tree order
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+    std::vector<double> m_z;
+    std::vector<std::uint32_t> m_indices;
+
+    std::vector<Node> m_nodes;  // Heap order, unused entries below leaves
+};
+
+#endif // SPATIALINDEX_HPP
@@ -0,0 +1,100 @@
+#ifndef STATIONKEY_HPP
+#define STATIONKEY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/*
+    Station ID packed into an integer, for use as a container key.
+
+    GHCN station IDs are 11 characters from [0-9A-Z] (see the ID column of ghcnd-stations.txt in
+    the GHCN readme.txt). Each character is a digit in base 37 (0 marks the end of a shorter ID),
+    so up to 12 characters fit into 64 bits. The first character is the most significant digit:
+    keys compare like the IDs they encode, a container sorted by key is sorted by ID.
+
+    Text is converted at the API edges only. Anything that is not a station ID (too long,
+    other characters) gives the invalid key, which is never found in a container.
+*/
+class StationKey
+{
+public:
+    // Invalid key
+    constexpr StationKey() = default;
+
+    constexpr explicit StationKey(std::string_view id)
+    {
+        if (id.empty() || id.size() > s_maxLength) {
+            return;
+        }
+        std::uint64_t value{0};
+        for (std::size_t i = 0; i < s_maxLength; ++i) {
+            const std::uint64_t digit = i < id.size() ? digitOf(id[i]) : 0;
+            if (i < id.size() && digit == 0) {
+                return;  // Not a station ID character
+            }
+            value = value * s_base + digit;
+        }
+        m_value = value;
+    };
+
+    constexpr bool isValid() const {return m_value != 0;};
+
+    constexpr std::uint64_t value() const {return m_value;};
+
+    std::string toString() const
+    {
+        char id[s_maxLength];
+        std::size_t length{0};
+        std::uint64_t value = m_value;
+        for (std::size_t i = s_maxLength; i-- > 0;) {
+            const auto digit = static_cast<unsigned>(value % s_base);
+            value /= s_base;
+            id[i] = digit == 0 ? '\0' : digit <= 10 ? static_cast<char>('0' + digit - 1) : static_cast<char>('A' + digit - 11);
+            if (digit != 0 && length == 0) {
+                length = i + 1;
+            }
+        }
+        return std::string(id, length);
+    };
+
+    constexpr auto operator<=>(const StationKey&) const = default;
+
+    static constexpr std::size_t s_maxLength{12};
+
+private:
+    static constexpr std::uint64_t s_base{37};  // End marker, 10 digits, 26 letters
+
+    static constexpr std::uint64_t digitOf(char c)
+    {
+        if (c >= '0' && c <= '9') {
+            return static_cast<std::uint64_t>(c - '0') + 1;
+        }
+        if (c >= 'A' && c <= 'Z') {
+            return static_cast<std::uint64_t>(c - 'A') + 11;
+        }
+        return 0;
+    };
+
+    std::uint64_t m_value{0};
+};
+
+static_assert(StationKey("GME00102380") < StationKey("GME00102381"));
+static_assert(StationKey("GM") < StationKey("GM0"));
+static_assert(StationKey("ZZZZZZZZZZZZ").isValid());
+static_assert(!StationKey("GME0010238a").isValid() && !StationKey("GME001023800X").isValid());
+
+
+template<>
+struct std::hash<StationKey>
+{
+    std::size_t operator()(const StationKey& key) const noexcept
+    {
+        // Keys of a country and network differ in the low digits only. Mix, so buckets are used evenly.
+        return static_cast<std::size_t>((key.value() * 0x9E3779B97F4A7C15ull) >> 16 ^ key.value());
+    }
+};
+
+#endif // STATIONKEY_HPP
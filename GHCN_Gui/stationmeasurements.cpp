@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <array>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "measurement.hpp"
+#include "stationmeasurements.hpp"
+
+
+StationMeasurements::StationMeasurements(const std::vector<Measurement>& measurements)
+{
+    // Count first, so every series is allocated exactly once.
+    std::array<std::size_t, s_numTypes> counts{};
+    for (const Measurement& m : measurements) {
+        const auto index = static_cast<std::size_t>(m.getType());
+        if (index < s_numTypes) {
+            ++counts[index];
+        }
+    }
+    for (std::size_t i = 0; i < s_numTypes; ++i) {
+        m_series[i].reserve(counts[i]);
+    }
+    for (const Measurement& m : measurements) {
+        const auto index = static_cast<std::size_t>(m.getType());
+        if (index < s_numTypes) {
+            m_series[index].push_back(m);
+        }
+    }
+    buildIndex();
+}
+
+
+StationMeasurements::StationMeasurements(std::array<std::vector<Measurement>, s_numTypes>&& series) :
+    m_series(std::move(series))
+{
+    buildIndex();
+}
+
+
+std::span<const Measurement>
+StationMeasurements::series(MeasurementType type) const
+{
+    const auto index = static_cast<std::size_t>(type);
+    if (index >= s_numTypes) {
+        return std::span<const Measurement>();
+    }
+    return std::span<const Measurement>(m_series[index]);
+}
+
+
+std::span<const Measurement>
+StationMeasurements::range(MeasurementType type, int startYear, int startMonth, int endYear, int endMonth) const
+{
+    const auto index = static_cast<std::size_t>(type);
+    if (index >= s_numTypes) {
+        return std::span<const Measurement>();
+    }
+    const MonthIndex& monthIndex = m_index[index];
+    const long first = std::clamp(monthIndex.slot(startYear, startMonth), 0L, monthIndex.numSlots());
+    const long last = std::clamp(monthIndex.slot(endYear, endMonth) + 1, 0L, monthIndex.numSlots());  // exclusive
+    if (first >= last) {
+        return std::span<const Measurement>();
+    }
+    const std::uint32_t begin = monthIndex.offset(first);
+    return std::span<const Measurement>(m_series[index]).subspan(begin, monthIndex.offset(last) - begin);
+}
+
+
+int
+StationMeasurements::firstYear(MeasurementType type) const
+{
+    const auto index = static_cast<std::size_t>(type);
+    return index < s_numTypes ? m_index[index].firstYear() : 1;
+}
+
+
+int
+StationMeasurements::lastYear(MeasurementType type) const
+{
+    const auto index = static_cast<std::size_t>(type);
+    return index < s_numTypes ? m_index[index].lastYear() : 0;
+}
+
+
+std::size_t
+StationMeasurements::size() const
+{
+    std::size_t total{0};
+    for (const auto& series : m_series) {
+        total += series.size();
+    }
+    return total;
+}
+
+
+std::size_t
+StationMeasurements::memoryUsage() const
+{
+    std::size_t total{sizeof(StationMeasurements)};
+    for (std::size_t i = 0; i < s_numTypes; ++i) {
+        total += m_series[i].capacity() * sizeof(Measurement) + m_index[i].memoryUsage();
+    }
+    return total;
+}
+
+
+void
+StationMeasurements::buildIndex()
+{
+    // Station files are sorted by date. Sort anyway if a source was not, the range lookups depend on it.
+    auto byDate = [](const Measurement& m1, const Measurement& m2) {return m1.getPackedDate() < m2.getPackedDate();};
+    for (std::size_t i = 0; i < s_numTypes; ++i) {
+        if (!std::ranges::is_sorted(m_series[i], byDate)) {
+            std::ranges::stable_sort(m_series[i], byDate);
+        }
+        m_index[i].build(m_series[i]);
+    }
+}
+
+
+void
+StationMeasurements::MonthIndex::build(std::span<const Measurement> series)
+{
+    if (series.empty()) {
+        return;
+    }
+    m_firstYear = series.front().getYear();
+    m_lastYear = series.back().getYear();
+    m_offsets.assign(static_cast<std::size_t>(m_lastYear - m_firstYear + 1) * 12 + 1, 0);
+
+    // Single pass: offset of each slot is the index of the first measurement not before it.
+    std::size_t i{0};
+    for (long s = 0; s < numSlots(); ++s) {
+        while (i < series.size() && slot(series[i].getYear(), series[i].getMonth()) < s) {
+            ++i;
+        }
+        m_offsets[static_cast<std::size_t>(s)] = static_cast<std::uint32_t>(i);
+    }
+    m_offsets.back() = static_cast<std::uint32_t>(series.size());
+}
@@ -0,0 +1,94 @@
+#ifndef STATIONMEASUREMENTS_HPP
+#define STATIONMEASUREMENTS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "measurement.hpp"
+
+/*
+    All measurements of a single station, partitioned by MeasurementType.
+
+    Each type is stored as one contiguous series sorted by date, so selecting a type is an
+    array lookup and aggregations scan dense memory instead of skipping over other elements.
+    Measurements of unknown type are dropped.
+
+    For every series an offset table with one entry per year and month (from the first to the
+    last year of the series) is built at construction. It resolves any year or month window to
+    a span in constant time.
+*/
+class StationMeasurements
+{
+public:
+    static constexpr std::size_t s_numTypes{static_cast<std::size_t>(MeasurementType::UNKNOWN)};
+
+    // No measurements.
+    StationMeasurements() = default;
+
+    explicit StationMeasurements(const std::vector<Measurement>& measurements);
+
+    // Adopts measurements already partitioned by type (e. g. the series of a binary sidecar). Every
+    // series must hold measurements of its type only.
+    explicit StationMeasurements(std::array<std::vector<Measurement>, s_numTypes>&& series);
+
+    // All measurements of the given type in ascending date order. Empty for unknown types.
+    std::span<const Measurement> series(MeasurementType type) const;
+
+    // Measurements of the given type from startMonth/startYear to endMonth/endYear (both inclusive).
+    // The window is clamped to the years available for the type. Empty if nothing is left.
+    std::span<const Measurement> range(MeasurementType type, int startYear, int startMonth, int endYear, int endMonth) const;
+
+    std::span<const Measurement> yearRange(MeasurementType type, int startYear, int endYear) const
+    {
+        return range(type, startYear, 1, endYear, 12);
+    };
+
+    // First and last year with measurements of the given type. firstYear() > lastYear() if there are none.
+    int firstYear(MeasurementType type) const;
+    int lastYear(MeasurementType type) const;
+
+    bool empty() const {return size() == 0;};
+
+    std::size_t size() const;
+
+    // Bytes allocated by this object, including unused vector capacity.
+    std::size_t memoryUsage() const;
+
+private:
+    class MonthIndex
+    {
+    public:
+        void build(std::span<const Measurement> series);
+
+        // Slot of a year/month relative to m_firstYear. May be outside [0, numSlots()].
+        long slot(int year, int month) const {return (static_cast<long>(year) - m_firstYear) * 12 + (month - 1);};
+
+        long numSlots() const {return m_offsets.empty() ? 0 : static_cast<long>(m_offsets.size()) - 1;};
+
+        // Index of the first measurement in or after the given slot (0 <= slot <= numSlots()).
+        std::uint32_t offset(long slot) const {return m_offsets[static_cast<std::size_t>(slot)];};
+
+        int firstYear() const {return m_firstYear;};
+        int lastYear() const {return m_lastYear;};
+
+        std::size_t memoryUsage() const {return m_offsets.capacity() * sizeof(std::uint32_t);};
+
+    private:
+        int m_firstYear{1};
+        int m_lastYear{0};
+        // numSlots() + 1 entries, the last one is the series size. Left empty for types without
+        // measurements, most of the registry is absent at any given station.
+        std::vector<std::uint32_t> m_offsets;
+    };
+
+    // Sorts the series by date where needed and builds their month indexes.
+    void buildIndex();
+
+    std::array<std::vector<Measurement>, s_numTypes> m_series;
+    std::array<MonthIndex, s_numTypes> m_index;
+};
+
+#endif // STATIONMEASUREMENTS_HPP
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <numbers>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "stationkey.hpp"
+#include "spatialindex.hpp"
+#include "stationmetadata.hpp"
+
+
+void
+StationMetadata::addStation(StationKey key, double latitude, double longitude, double elevation, std::string_view name)
+{
+    m_keys.push_back(key);
+    m_latitudes.push_back(latitude);
+    m_longitudes.push_back(longitude);
+    m_elevations.push_back(elevation);
+    const double latitudeRadians = latitude * std::numbers::pi_v<double> / 180;
+    m_latitudeRadians.push_back(latitudeRadians);
+    m_longitudeRadians.push_back(longitude * std::numbers::pi_v<double> / 180);
+    m_cosLatitudes.push_back(std::cos(latitudeRadians));
+    m_names.append(name);
+    m_nameOffsets.push_back(static_cast<std::uint32_t>(m_names.size()));
+}
+
+
+void
+StationMetadata::reserveStations(std::size_t count)
+{
+    m_keys.reserve(count);
+    m_latitudes.reserve(count);
+    m_longitudes.reserve(count);
+    m_elevations.reserve(count);
+    m_latitudeRadians.reserve(count);
+    m_longitudeRadians.reserve(count);
+    m_cosLatitudes.reserve(count);
+    m_nameOffsets.reserve(count + 1);
+    m_names.reserve(count * 20);  // Most names are shorter than 20 characters
+}
+
+
+std::string_view
+StationMetadata::name(std::size_t index) const
+{
+    return std::string_view(m_names).substr(m_nameOffsets[index], m_nameOffsets[index + 1] - m_nameOffsets[index]);
+}
+
+
+void
+StationMetadata::buildSpatialIndex()
+{
+    m_spatialIndex = SpatialIndex(m_latitudes, m_longitudes);
+}
+
+
+void
+StationMetadata::setInventory(std::vector<std::pair<StationKey, InventoryEntry>> rows)
+{
+    // Lines of a station are adjacent in the NOAA files. Rows are sorted by key anyway, so the index
+    // stays correct for files merged by hand.
+    auto byKey = [](const auto& row1, const auto& row2) {return row1.first < row2.first;};
+    if (!std::ranges::is_sorted(rows, byKey)) {
+        std::ranges::stable_sort(rows, byKey);
+    }
+
+    m_inventory.clear();
+    m_inventory.reserve(rows.size());
+    std::vector<IndexSlot> groups;
+    for (auto first = rows.begin(); first != rows.end();) {
+        auto last = std::find_if(first, rows.end(), [first](const auto& row) {return row.first != first->first;});
+        groups.push_back(IndexSlot{first->first, static_cast<std::uint32_t>(m_inventory.size()), static_cast<std::uint32_t>(last - first)});
+        for (auto row = first; row != last; ++row) {
+            m_inventory.push_back(row->second);
+        }
+        first = last;
+    }
+
+    // Linear probing. At most half filled, so probe sequences stay short.
+    m_inventoryIndex.assign(std::bit_ceil(std::max<std::size_t>(16, 2 * groups.size())), IndexSlot{StationKey(), 0, 0});
+    const std::size_t mask = m_inventoryIndex.size() - 1;
+    for (const IndexSlot& group : groups) {
+        std::size_t slot = std::hash<StationKey>{}(group.key) & mask;
+        while (m_inventoryIndex[slot].key.isValid()) {
+            slot = (slot + 1) & mask;
+        }
+        m_inventoryIndex[slot] = group;
+    }
+}
+
+
+std::span<const StationMetadata::InventoryEntry>
+StationMetadata::inventory(StationKey key) const
+{
+    if (!key.isValid() || m_inventoryIndex.empty()) {
+        return {};
+    }
+    const std::size_t mask = m_inventoryIndex.size() - 1;
+    for (std::size_t slot = std::hash<StationKey>{}(key) & mask; m_inventoryIndex[slot].key.isValid(); slot = (slot + 1) & mask) {
+        if (m_inventoryIndex[slot].key == key) {
+            return std::span<const InventoryEntry>(m_inventory).subspan(m_inventoryIndex[slot].first, m_inventoryIndex[slot].count);
+        }
+    }
+    return {};
+}
+
+
+bool
+StationMetadata::covers(StationKey key, MeasurementType type, int startYear, int endYear) const
+{
+    return std::ranges::any_of(inventory(key), [=](const InventoryEntry& entry) {
+        return entry.type == type && entry.startYear <= startYear && entry.endYear >= endYear;
+    });
+}
@@ -0,0 +1,102 @@
+#ifndef STATIONMETADATA_HPP
+#define STATIONMETADATA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "measurement.hpp"
+#include "stationkey.hpp"
+#include "spatialindex.hpp"
+
+/*
+    Stations and inventory in flat arrays.
+
+    Stations are stored column-wise: one array per field, addressed by station index. Radians
+    and the cosine of the latitude are kept next to the degrees, so distance calculations do not
+    convert per station. Names are kept in one pool.
+
+    The inventory holds the entries of all stations grouped by station. An open addressing hash
+    table maps a StationKey to its group, so a coverage check is one probe plus a few
+    comparisons, whatever the size of the inventory. A SpatialIndex over the station locations answers radius and nearest queries.
+
+    All arrays hold trivially copyable elements. MetadataSnapshot stores and loads each of them
+    with a single copy.
+*/
+class StationMetadata
+{
+public:
+    // Years with measurements of one element at a station (a line of the inventory file).
+    struct InventoryEntry
+    {
+        std::int16_t startYear;
+        std::int16_t endYear;
+        MeasurementType type;
+    };
+
+    void addStation(StationKey key, double latitude, double longitude, double elevation, std::string_view name);
+
+    void reserveStations(std::size_t count);
+
+    std::size_t stationCount() const {return m_keys.size();};
+
+    StationKey key(std::size_t index) const {return m_keys[index];};
+    double latitude(std::size_t index) const {return m_latitudes[index];};
+    double longitude(std::size_t index) const {return m_longitudes[index];};
+    double elevation(std::size_t index) const {return m_elevations[index];};
+    std::string_view name(std::size_t index) const;
+
+    std::span<const double> latitudes() const {return m_latitudes;};
+    std::span<const double> longitudes() const {return m_longitudes;};
+
+    double latitudeRadians(std::size_t index) const {return m_latitudeRadians[index];};
+    double longitudeRadians(std::size_t index) const {return m_longitudeRadians[index];};
+    double cosLatitude(std::size_t index) const {return m_cosLatitudes[index];};
+
+    // Replaces the inventory. Entries of a station need not be adjacent.
+    void setInventory(std::vector<std::pair<StationKey, InventoryEntry>> rows);
+
+    // Inventory entries of a station, empty if it has none.
+    std::span<const InventoryEntry> inventory(StationKey key) const;
+
+    std::size_t inventorySize() const {return m_inventory.size();};
+
+    // True if the inventory lists measurements of type at the station for every year in [startYear, endYear].
+    bool covers(StationKey key, MeasurementType type, int startYear, int endYear) const;
+
+    // Call after the last addStation().
+    void buildSpatialIndex();
+
+    const SpatialIndex& spatialIndex() const {return m_spatialIndex;};
+
+private:
+    friend class MetadataSnapshot;
+
+    struct IndexSlot
+    {
+        StationKey key;  // Invalid: empty slot
+        std::uint32_t first;
+        std::uint32_t count;
+    };
+
+    std::vector<StationKey> m_keys;
+    std::vector<double> m_latitudes;
+    std::vector<double> m_longitudes;
+    std::vector<double> m_elevations;
+    std::vector<double> m_latitudeRadians;
+    std::vector<double> m_longitudeRadians;
+    std::vector<double> m_cosLatitudes;
+    std::vector<std::uint32_t> m_nameOffsets{0};  // Name i: [m_nameOffsets[i], m_nameOffsets[i + 1])
+    std::string m_names;
+
+    std::vector<InventoryEntry> m_inventory;  // Grouped by station
+    std::vector<IndexSlot> m_inventoryIndex;  // Size is a power of two, at most half filled
+
+    SpatialIndex m_spatialIndex;
+};
+
+#endif // STATIONMETADATA_HPP
@@ -0,0 +1,25 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "measurement.hpp"
+#include "yearseries.hpp"
+
+
+const YearSeries*
+YearSeries::find(std::span<const YearSeries> directory, MeasurementType type)
+{
+    const auto typeIndex = static_cast<std::uint32_t>(type);
+    auto it = std::ranges::lower_bound(directory, typeIndex, {}, &YearSeries::type);
+    return it != directory.end() && it->type == typeIndex ? &*it : nullptr;
+}
+
+
+bool
+YearSeries::fits(std::span<const YearSeries> directory, std::size_t perYear, std::size_t extra, std::size_t size)
+{
+    return std::ranges::all_of(directory, [=](const YearSeries& series) {
+        return std::uint64_t{series.first} + std::uint64_t{series.yearCount} * perYear + extra <= size;
+    });
+}
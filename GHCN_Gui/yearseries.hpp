@@ -0,0 +1,33 @@
+#ifndef YEARSERIES_HPP
+#define YEARSERIES_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "measurement.hpp"
+
+/*
+    Directory entry for the per-year data of one element, shared by DataCompleteness and MonthlyAggregates.
+
+    Both keep the data of all elements of a station in one vector, and a directory of entries
+    ascending by type that gives the years of an element and the index of its first element.
+    The entries are stored in the binary sidecar as they are (see BinaryCache).
+*/
+struct YearSeries
+{
+    std::uint32_t type;  // MeasurementType
+    std::int32_t firstYear;
+    std::uint32_t yearCount;
+    std::uint32_t first;  // Index of the data of firstYear
+
+    int lastYear() const {return firstYear + static_cast<int>(yearCount) - 1;};
+
+    // Entry of the type, nullptr if the type has none.
+    static const YearSeries* find(std::span<const YearSeries> directory, MeasurementType type);
+
+    // True if the data of every entry, perYear elements per year plus extra, lies within size elements.
+    static bool fits(std::span<const YearSeries> directory, std::size_t perYear, std::size_t extra, std::size_t size);
+};
+
+#endif // YEARSERIES_HPP
@@ -0,0 +1,507 @@
+/*
+    Micro benchmarks for the data layer of GHCN_Gui.
+
+    Usage: GHCN_Gui_Bench <station csv file> [repetitions]
+           GHCN_Gui_Bench --startup <data dir> <stations file> <inventory file> [repetitions]
+           GHCN_Gui_Bench --spatial [queries]
+
+    e. g.: GHCN_Gui_Bench ../../data/GME00102380.csv
+           GHCN_Gui_Bench --startup ../../data/ ghcnd-stations_gm.txt ghcnd-inventory_gm.txt
+           GHCN_Gui_Bench --startup ../../data/ ghcnd-stations.txt ghcnd-inventory.txt
+
+    Build in release mode, otherwise the numbers are meaningless.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <numbers>
+#include <random>
+#include <regex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "measurement.hpp"
+#include "station.hpp"
+#include "dataprovider.hpp"
+#include "distancekernel.hpp"
+#include "metadatasnapshot.hpp"
+#include "spatialindex.hpp"
+#include "measurementparser.hpp"
+#include "mappedfile.hpp"
+#include "binarycache.hpp"
+#include "stationmeasurements.hpp"
+#include "gzipreader.hpp"
+
+#ifdef GHCN_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+
+// Returns the best wall time in milliseconds over the given number of repetitions.
+static double
+bestOf(int repetitions, const std::function<void()>& func)
+{
+    double best = 1e300;
+    for (int i = 0; i < repetitions; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        auto stop = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+    }
+    return best;
+}
+
+
+// Reference: the regex tokenizer DataProvider::readMeasurementsForStation used before the scanner.
+static std::size_t
+readWithRegex(const std::string& filename)
+{
+    std::vector<Measurement> measurements;
+    if (std::ifstream inStream{filename, std::ios::in}) {
+        std::string line;
+        std::smatch match;
+        std::regex item{"[^,]+"};
+        while (std::getline(inStream, line)) {
+            std::regex_search(line, match, item);
+            line = match.suffix();
+            std::regex_search(line, match, item);
+            std::string date{match.str()};
+            line = match.suffix();
+            std::regex_search(line, match, item);
+            std::string element{match.str()};
+            line = match.suffix();
+            std::regex_search(line, match, item);
+            int value = stoi(match.str());
+            measurements.push_back(Measurement(date, value, element));
+        }
+    }
+    return measurements.size();
+}
+
+
+static std::size_t
+readWithScanner(const std::string& filename)
+{
+    std::vector<Measurement> measurements;
+    if (std::ifstream inStream{filename, std::ios::in | std::ios::binary}) {
+        std::string text;
+        inStream.seekg(0, std::ios::end);
+        text.resize(static_cast<std::size_t>(inStream.tellg()));
+        inStream.seekg(0, std::ios::beg);
+        inStream.read(text.data(), static_cast<std::streamsize>(text.size()));
+        MeasurementParser::parseCsv(text, measurements);
+    }
+    return measurements.size();
+}
+
+
+static std::size_t
+readWithMappedScanner(const std::string& filename)
+{
+    std::vector<Measurement> measurements;
+    MappedFile mappedFile(filename);
+    if (mappedFile.isValid()) {
+        mappedFile.adviseSequential();
+        MeasurementParser::parseCsv(mappedFile.view(), measurements);
+    }
+    return measurements.size();
+}
+
+
+static std::size_t
+readWithParallelScanner(const std::string& filename, unsigned numChunks)
+{
+    std::vector<Measurement> measurements;
+    MappedFile mappedFile(filename);
+    if (mappedFile.isValid()) {
+        mappedFile.adviseSequential();
+        MeasurementParser::parseParallel(mappedFile.view(), measurements, numChunks);
+    }
+    return measurements.size();
+}
+
+
+static void
+benchCsvIngest(const std::string& filename, int repetitions)
+{
+    std::size_t countBefore{0};
+    std::size_t countAfter{0};
+    double before = bestOf(repetitions, [&]() {countBefore = readWithRegex(filename);});
+    double after = bestOf(repetitions, [&]() {countAfter = readWithScanner(filename);});
+    std::size_t countMapped{0};
+    double mapped = bestOf(repetitions, [&]() {countMapped = readWithMappedScanner(filename);});
+
+    std::cout << std::format("CSV ingest of {}\n", filename);
+    std::cout << std::format("  regex tokenizer: {:>9.2f} ms ({} measurements)\n", before, countBefore);
+    std::cout << std::format("  scanner:         {:>9.2f} ms ({} measurements)\n", after, countAfter);
+    std::cout << std::format("  scanner (mmap):  {:>9.2f} ms ({} measurements)\n", mapped, countMapped);
+    for (unsigned numChunks : {2u, 4u, 8u, std::max(1u, std::thread::hardware_concurrency())}) {
+        std::size_t countParallel{0};
+        double parallel = bestOf(repetitions, [&]() {countParallel = readWithParallelScanner(filename, numChunks);});
+        std::cout << std::format("  mmap, {:>2} chunks: {:>9.2f} ms ({} measurements)\n", numChunks, parallel, countParallel);
+    }
+    const std::string cacheFilename = BinaryCache::cacheFilenameFor(filename);
+    std::vector<Measurement> parsed;
+    MappedFile mappedFile(filename);
+    MeasurementParser::parseCsv(mappedFile.view(), parsed);
+    if (BinaryCache::write(cacheFilename, filename, StationMeasurements(parsed))) {
+        std::size_t countCached{0};
+        double cached = bestOf(repetitions, [&]() {
+            StationMeasurements measurements;
+            BinaryCache::read(cacheFilename, filename, measurements);
+            countCached = measurements.size();
+        });
+        std::cout << std::format("  binary sidecar:  {:>9.2f} ms ({} measurements)\n", cached, countCached);
+    }
+    std::cout << std::format("  speedup:         {:>9.1f} x (stream), {:.1f} x (mmap)\n", before / after, before / mapped);
+}
+
+
+#ifdef GHCN_HAVE_ZLIB
+
+// Compresses the station file into a temporary .csv.gz and compares streaming it with parsing the plain file.
+static void
+benchGzipIngest(const std::string& filename, int repetitions)
+{
+    MappedFile mappedFile(filename);
+    if (!mappedFile.isValid()) {
+        return;
+    }
+    const std::string_view text = mappedFile.view();
+    const std::string gzFilename = filename + ".bench.gz";
+    gzFile file = gzopen(gzFilename.c_str(), "wb6");
+    if (file == nullptr) {
+        return;
+    }
+    gzwrite(file, text.data(), static_cast<unsigned>(text.size()));
+    gzclose(file);
+
+    std::size_t countPlain{0};
+    double plain = bestOf(repetitions, [&]() {countPlain = readWithMappedScanner(filename);});
+    std::size_t countInflateOnly{0};
+    double inflateOnly = bestOf(repetitions, [&]() {
+        countInflateOnly = 0;
+        GzipReader::readLines(gzFilename, [&countInflateOnly](std::string_view lines) {countInflateOnly += lines.size();});
+    });
+    std::size_t countStreamed{0};
+    double streamed = bestOf(repetitions, [&]() {
+        std::vector<Measurement> measurements;
+        MeasurementParser::parseGzip(gzFilename, measurements);
+        countStreamed = measurements.size();
+    });
+    const auto compressedSize = std::filesystem::file_size(gzFilename);
+    std::filesystem::remove(gzFilename);
+
+    std::cout << std::format("Compressed ingest ({:.1f} MiB => {:.1f} MiB)\n", compressedSize / 1048576.0, countInflateOnly / 1048576.0);
+    std::cout << std::format("  plain, mmap:     {:>9.2f} ms ({} measurements)\n", plain, countPlain);
+    std::cout << std::format("  inflate only:    {:>9.2f} ms\n", inflateOnly);
+    std::cout << std::format("  inflate + parse: {:>9.2f} ms ({} measurements)\n", streamed, countStreamed);
+}
+
+#endif  // GHCN_HAVE_ZLIB
+
+
+// Reference: DataProvider::readStations before the fixed column parser (getline, substr, stod).
+static std::size_t
+readStationsWithGetline(const std::string& filename)
+{
+    std::vector<Station> stations;
+    if (std::ifstream inStream{filename, std::ios::in}) {
+        std::string line;
+        while (std::getline(inStream, line)) {
+            std::string id = line.substr(0, 11);
+            double latitude = std::stod(line.substr(12, 8));
+            double longitude = std::stod(line.substr(21, 9));
+            double elevation = std::stod(line.substr(31, 6));
+            std::string name = line.substr(41, 30);
+            size_t endpos = name.find_last_not_of(" \t\n\r");
+            if (std::string::npos != endpos)
+                name.erase(endpos + 1);
+            stations.push_back(Station(id, latitude, longitude, elevation, name));
+        }
+    }
+    return stations.size();
+}
+
+
+// Reference: DataProvider::readInventory before the fixed column parser (getline, substr, stoi).
+static std::size_t
+readInventoryWithGetline(const std::string& filename)
+{
+    std::vector<std::tuple<std::string, MeasurementType, int, int>> entries;
+    if (std::ifstream inStream{filename, std::ios::in}) {
+        std::string line;
+        while (std::getline(inStream, line)) {
+            if (line.size() < 45) {
+                continue;
+            }
+            const std::string id = line.substr(0, 11);
+            const MeasurementType type = Measurement::typeFromString(std::string_view(line).substr(31, 4));
+            if (type == MeasurementType::UNKNOWN) {
+                continue;
+            }
+            entries.emplace_back(id, type, stoi(line.substr(36, 4)), stoi(line.substr(41, 4)));
+        }
+    }
+    return entries.size();
+}
+
+
+// DataProvider construction (stations and inventory) against the previous line based parsers.
+static void
+benchStartup(const std::string& dataDirName, const std::string& stationFileName, const std::string& inventoryFileName, int repetitions)
+{
+    std::size_t countStations{0};
+    double stationsBefore = bestOf(repetitions, [&]() {countStations = readStationsWithGetline(dataDirName + stationFileName);});
+    std::size_t countInventory{0};
+    double inventoryBefore = bestOf(repetitions, [&]() {countInventory = readInventoryWithGetline(dataDirName + inventoryFileName);});
+    // DataProvider reads on worker threads. Its destructor waits for them.
+    const std::string snapshotFilename = MetadataSnapshot::snapshotFilenameFor(dataDirName + stationFileName);
+    double parsed = bestOf(repetitions, [&]() {
+        std::filesystem::remove(snapshotFilename);
+        DataProvider dataProvider(dataDirName, stationFileName, inventoryFileName, ".csv");
+    });
+    double snapshot = bestOf(repetitions, [&]() {DataProvider dataProvider(dataDirName, stationFileName, inventoryFileName, ".csv");});
+
+    std::cout << std::format("Startup with {} ({} stations) and {} ({} inventory entries)\n",
+                             stationFileName, countStations, inventoryFileName, countInventory);
+    std::cout << std::format("  getline stations:      {:>9.2f} ms\n", stationsBefore);
+    std::cout << std::format("  getline inventory:     {:>9.2f} ms\n", inventoryBefore);
+    std::cout << std::format("  getline total:         {:>9.2f} ms\n", stationsBefore + inventoryBefore);
+    std::cout << std::format("  DataProvider, parsed:  {:>9.2f} ms ({:.1f} x, snapshot written)\n", parsed, (stationsBefore + inventoryBefore) / parsed);
+    std::cout << std::format("  DataProvider, snapshot:{:>9.2f} ms ({:.1f} x)\n", snapshot, (stationsBefore + inventoryBefore) / snapshot);
+}
+
+
+// Seasonal averages of a station as the main window shows them (four seasons, TMAX and TMIN), in a new
+// DataProvider each time: first from the parsed station file, then from the aggregates in its sidecar.
+static void
+benchReopen(const std::string& dataDirName, const std::string& stationFileName, const std::string& inventoryFileName,
+            const std::string& stationId, int repetitions)
+{
+    auto seasons = [&](DataProvider& dataProvider) {
+        std::size_t years{0};
+        for (MeasurementType type : {MeasurementType::TMAX, MeasurementType::TMIN}) {
+            for (const auto& [startMonth, endMonth] : {std::pair{3, 5}, std::pair{6, 8}, std::pair{9, 11}, std::pair{12, 2}}) {
+                years += dataProvider.getAveragesForMonthRange(stationId, 1900, 2030, startMonth, endMonth, type)->size();
+            }
+        }
+        return years;
+    };
+    std::size_t years{0};
+    double firstOpen{0};
+    double reopen{0};
+    for (int i = 0; i < repetitions; ++i) {
+        DataProvider parsed(dataDirName, stationFileName, inventoryFileName, ".csv");
+        parsed.waitUntilReady();
+        for (const auto& entry : std::filesystem::directory_iterator(dataDirName)) {
+            if (entry.path().filename().string().starts_with(stationId) && entry.path().extension() == ".ghcnbin") {
+                std::filesystem::remove(entry.path());
+            }
+        }
+        const double first = bestOf(1, [&]() {years = seasons(parsed);});
+        DataProvider reopened(dataDirName, stationFileName, inventoryFileName, ".csv");
+        reopened.waitUntilReady();
+        const double again = bestOf(1, [&]() {seasons(reopened);});
+        firstOpen = i == 0 ? first : std::min(firstOpen, first);
+        reopen = i == 0 ? again : std::min(reopen, again);
+    }
+    std::cout << std::format("Seasonal averages of {} (8 series, {} values)\n", stationId, years);
+    std::cout << std::format("  first open (parse, sidecar written): {:>9.3f} ms\n", firstOpen);
+    std::cout << std::format("  reopen (aggregates from sidecar):    {:>9.3f} ms ({:.0f} x)\n", reopen, firstOpen / reopen);
+}
+
+
+// Same formula as DataProvider::haversine.
+static double
+haversine(double lat1, double lat2, double lng1, double lng2)
+{
+    const double r_lat1 = lat1 * std::numbers::pi_v<double> / 180;
+    const double r_lng1 = lng1 * std::numbers::pi_v<double> / 180;
+    const double r_lat2 = lat2 * std::numbers::pi_v<double> / 180;
+    const double r_lng2 = lng2 * std::numbers::pi_v<double> / 180;
+    const double a = std::pow(std::sin((r_lat2 - r_lat1) / 2), 2) +
+                     std::pow(std::sin((r_lng2 - r_lng1) / 2), 2) * std::cos(r_lat1) * std::cos(r_lat2);
+    return SpatialIndex::s_earthRadius * 2 * std::atan2(std::sqrt(a), std::sqrt(1 - a));
+}
+
+
+// Radius and nearest queries: brute force (distance to every station, as calcNearestStations did) against
+// SpatialIndex. Stations are spread uniformly over the sphere, real station lists are denser on land.
+static void
+benchSpatialIndex(int numQueries)
+{
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    std::uniform_real_distribution<double> longitudes(-180.0, 180.0);
+    auto randomLatitude = [&]() {return std::asin(uniform(random)) * 180 / std::numbers::pi_v<double>;};
+
+    std::vector<std::pair<double, double>> queries;
+    for (int i = 0; i < numQueries; ++i) {
+        queries.emplace_back(randomLatitude(), longitudes(random));
+    }
+
+    for (std::size_t numStations : {1000u, 10000u, 120000u}) {
+        std::vector<double> lats;
+        std::vector<double> lngs;
+        for (std::size_t i = 0; i < numStations; ++i) {
+            lats.push_back(randomLatitude());
+            lngs.push_back(longitudes(random));
+        }
+        SpatialIndex index;
+        const double build = bestOf(1, [&]() {index = SpatialIndex(lats, lngs);});
+        std::cout << std::format("{} stations (index built in {:.2f} ms), {} queries\n", numStations, build, numQueries);
+
+        for (double radius : {100.0, 500.0}) {
+            std::size_t hitsBrute{0};
+            const double brute = bestOf(3, [&]() {
+                hitsBrute = 0;
+                for (const auto& [lat, lng] : queries) {
+                    std::vector<std::pair<std::size_t, double>> hits;
+                    for (std::size_t i = 0; i < numStations; ++i) {
+                        const double distance = haversine(lat, lats[i], lng, lngs[i]);
+                        if (distance <= radius) {
+                            hits.emplace_back(i, distance);
+                        }
+                    }
+                    std::ranges::sort(hits, {}, &std::pair<std::size_t, double>::second);
+                    hitsBrute += hits.size();
+                }
+            });
+            std::size_t hitsIndex{0};
+            const double indexed = bestOf(3, [&]() {
+                hitsIndex = 0;
+                for (const auto& [lat, lng] : queries) {
+                    std::vector<std::pair<std::size_t, double>> hits;
+                    for (std::uint32_t i : index.withinRadius(lat, lng, radius)) {
+                        const double distance = haversine(lat, lats[i], lng, lngs[i]);
+                        if (distance <= radius) {
+                            hits.emplace_back(i, distance);
+                        }
+                    }
+                    std::ranges::sort(hits, {}, &std::pair<std::size_t, double>::second);
+                    hitsIndex += hits.size();
+                }
+            });
+            std::cout << std::format("  radius {:>4.0f} km: brute force {:>9.2f} us, index {:>8.2f} us per query ({:.0f} x, {} / {} hits)\n",
+                                     radius, brute * 1000 / numQueries, indexed * 1000 / numQueries, brute / indexed, hitsBrute, hitsIndex);
+        }
+
+        // Brute force over unit vectors: the whole column set is streamed once per query.
+        std::vector<double> xs(numStations);
+        std::vector<double> ys(numStations);
+        std::vector<double> zs(numStations);
+        std::vector<std::uint32_t> ids(numStations);
+        for (std::size_t i = 0; i < numStations; ++i) {
+            double coords[3];
+            SpatialIndex::toUnitVector(lats[i], lngs[i], coords);
+            xs[i] = coords[0];
+            ys[i] = coords[1];
+            zs[i] = coords[2];
+            ids[i] = static_cast<std::uint32_t>(i);
+        }
+        const double chord = 2 * std::sin(500.0 / SpatialIndex::s_earthRadius / 2);
+        for (bool simd : {false, true}) {
+            DistanceKernel::enableSimd(simd);
+            std::size_t hits{0};
+            const double kernel = bestOf(3, [&]() {
+                hits = 0;
+                std::vector<std::uint32_t> result;
+                for (const auto& [lat, lng] : queries) {
+                    double query[3];
+                    SpatialIndex::toUnitVector(lat, lng, query);
+                    result.clear();
+                    DistanceKernel::selectWithin(xs.data(), ys.data(), zs.data(), ids.data(), numStations, query, chord * chord, result);
+                    hits += result.size();
+                }
+            });
+            const double bytes = static_cast<double>(numStations) * 3 * sizeof(double) * numQueries;
+            std::cout << std::format("  kernel {:<7} brute force {:>9.2f} us per query, {:>5.1f} GB/s ({} hits within 500 km)\n",
+                                     DistanceKernel::usesSimd() ? "avx2:" : "scalar:", kernel * 1000 / numQueries, bytes / kernel / 1e6, hits);
+        }
+        DistanceKernel::enableSimd(true);
+
+        constexpr std::size_t k{5};
+        std::size_t sameNearest{0};
+        const double brute = bestOf(3, [&]() {
+            for (const auto& [lat, lng] : queries) {
+                std::vector<std::pair<double, std::uint32_t>> all;
+                for (std::size_t i = 0; i < numStations; ++i) {
+                    all.emplace_back(haversine(lat, lats[i], lng, lngs[i]), static_cast<std::uint32_t>(i));
+                }
+                std::ranges::partial_sort(all, all.begin() + k);
+                sameNearest += all.front().second == index.nearest(lat, lng, 1, 20000).front() ? 1 : 0;
+            }
+        });
+        const double indexed = bestOf(3, [&]() {
+            for (const auto& [lat, lng] : queries) {
+                index.nearest(lat, lng, k, 20000);
+            }
+        });
+        std::cout << std::format("  nearest {}:       brute force {:>9.2f} us, index {:>8.2f} us per query ({:.0f} x, {} of {} agree)\n",
+                                 k, brute * 1000 / numQueries, indexed * 1000 / numQueries, brute / indexed, sameNearest / 3, numQueries);
+    }
+}
+
+
+static void
+reportMemory(const std::string& filename)
+{
+    std::vector<Measurement> measurements;
+    MappedFile mappedFile(filename);
+    if (mappedFile.isValid()) {
+        MeasurementParser::parseCsv(mappedFile.view(), measurements);
+    }
+    measurements.shrink_to_fit();  // As stored in DataProvider::m_MeasurementsCache
+
+    // Previous layout: four ints plus the enum.
+    constexpr std::size_t previousSize = 4 * sizeof(int) + sizeof(int);
+    const std::size_t count = measurements.size();
+    std::cout << std::format("Measurement cache footprint for {} measurements\n", count);
+    std::cout << std::format("  previous layout: {:>2} bytes/measurement, {:>9.2f} MiB\n",
+                             previousSize, count * previousSize / 1048576.0);
+    std::cout << std::format("  current layout:  {:>2} bytes/measurement, {:>9.2f} MiB\n",
+                             sizeof(Measurement), measurements.capacity() * sizeof(Measurement) / 1048576.0);
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc >= 5 && std::string(argv[1]) == "--startup") {
+        benchStartup(argv[2], argv[3], argv[4], argc > 5 ? std::stoi(argv[5]) : 5);
+        return EXIT_SUCCESS;
+    }
+    if (argc >= 6 && std::string(argv[1]) == "--reopen") {
+        benchReopen(argv[2], argv[3], argv[4], argv[5], argc > 6 ? std::stoi(argv[6]) : 5);
+        return EXIT_SUCCESS;
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--spatial") {
+        benchSpatialIndex(argc > 2 ? std::stoi(argv[2]) : 1000);
+        return EXIT_SUCCESS;
+    }
+    if (argc < 2) {
+        std::cout << std::format("Usage: {} <station csv file> [repetitions]\n", argv[0]);
+        std::cout << std::format("       {} --startup <data dir> <stations file> <inventory file> [repetitions]\n", argv[0]);
+        std::cout << std::format("       {} --spatial [queries]\n", argv[0]);
+        std::cout << std::format("       {} --reopen <data dir> <stations file> <inventory file> <station id> [repetitions]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const std::string filename{argv[1]};
+    const int repetitions = argc > 2 ? std::stoi(argv[2]) : 5;
+
+    benchCsvIngest(filename, repetitions);
+#ifdef GHCN_HAVE_ZLIB
+    benchGzipIngest(filename, repetitions);
+#endif
+    reportMemory(filename);
+    return EXIT_SUCCESS;
+}
@@ -1,16 +1,21 @@
 #include "station.hpp"
 
 Station::Station(const std::string &id, const double &latitude, const double &longitude, const double &elevation, const std::string &name) :
-    m_id(id),
+    m_key(id),
     m_latitude(latitude),
     m_longitude(longitude),
     m_elevation(elevation),
     m_name(name)
 {}
 
-const std::string& Station::getId() const
+std::string Station::getId() const
 {
-    return m_id;
+    return m_key.toString();
+}
+
+StationKey Station::getKey() const
+{
+    return m_key;
 }
 
 const double& Station::getLatitude() const
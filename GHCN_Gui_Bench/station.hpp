@@ -3,6 +3,8 @@
 
 #include <string>
 
+#include "stationkey.hpp"
+
 /*
        Station data according to GHCN readme.txt, retrieved from
 
@@ -18,6 +20,9 @@
     LONGITUDE    longitude (in decimal degrees).
     ELEVATION    elevation (in meters, missing = -999.9).
     NAME         Name of station
+
+    The ID is kept as a StationKey, getId() converts it back to text. Only the reference parser of
+    the benchmark builds Station objects, the application keeps stations in StationMetadata.
 */
 
 
@@ -26,7 +31,9 @@ class Station
 public:
     Station(const std::string& id, const double& latitude, const double& longitude, const double& elevation, const std::string& name);
 
-    const std::string& getId() const;
+    std::string getId() const;
+
+    StationKey getKey() const;
 
     const double& getLatitude() const;
 
@@ -37,7 +44,7 @@ public:
     const std::string& getName() const;
 
 protected:
-    std::string m_id;
+    StationKey m_key;
     double m_latitude;
     double m_longitude;
     double m_elevation;
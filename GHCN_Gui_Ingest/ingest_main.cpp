@@ -0,0 +1,49 @@
+/*
+    Rebuilds the per-station store from GHCN-Daily by_year files.
+
+    Usage: GHCN_Gui_Ingest <output dir> <memory budget in MiB> <by_year file>...
+
+    e. g.: GHCN_Gui_Ingest ../../data/stations/ 4096 by_year/1990.csv.gz by_year/1991.csv.gz
+
+    Writes one <ID>.csv with its binary sidecar per station found in the given files.
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <string>
+
+#include "byyearingest.hpp"
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 4) {
+        std::cout << std::format("Usage: {} <output dir> <memory budget in MiB> <by_year file>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const std::string outputDirName{argv[1]};
+    const std::size_t memoryBudget = std::stoull(argv[2]) << 20;
+
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start]() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    ByYearIngest ingest(outputDirName, memoryBudget);
+    for (int i = 3; i < argc; ++i) {
+        if (!ingest.addFile(argv[i])) {
+            std::cerr << std::format("Reading {} failed\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+        std::cout << std::format("{:>8.1f} s  {} ({} rows so far, {} spills)\n", elapsed(), argv[i], ingest.rowCount(), ingest.spillCount());
+    }
+    const bool success = ingest.finish();
+    std::cout << std::format("{:>8.1f} s  {} stations written to {}\n", elapsed(), ingest.stationCount(), outputDirName);
+    if (!success) {
+        std::cerr << "Some station files could not be written\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -1,10 +1,56 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <numbers>
+#include <numeric>
 #include <string>
 #include <format>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
 
 #define BOOST_TEST_MODULE GHCN_Gui_Test
 #include <boost/test/included/unit_test.hpp>
 
 #include "dataprovider.hpp"
+#include "measurementparser.hpp"
+#include "binarycache.hpp"
+#include "stationmeasurements.hpp"
+#include "gzipreader.hpp"
+#include "byyearingest.hpp"
+#include "measurementfilter.hpp"
+#include "stationkey.hpp"
+#include "stationmetadata.hpp"
+#include "metadatasnapshot.hpp"
+#include "spatialindex.hpp"
+#include "distancekernel.hpp"
+#include "datacompleteness.hpp"
+#include "monthlyaggregates.hpp"
+#include "measurementscache.hpp"
+
+#ifdef GHCN_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// Empty directory for the files of a test case. Removed when the test case ends, also after a failed BOOST_REQUIRE.
+struct TempDir
+{
+    TempDir() :
+        dir(std::filesystem::temp_directory_path() / ("ghcn_gui_test_" + boost::unit_test::framework::current_test_case().p_name.get()))
+    {
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+    }
+
+    ~TempDir()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+
+    const std::filesystem::path dir;
+};
 
 BOOST_AUTO_TEST_SUITE(public_api)
 
@@ -31,6 +77,63 @@ BOOST_AUTO_TEST_CASE(api_nearest_stations)
     // }
 }
 
+BOOST_AUTO_TEST_CASE(api_nearest_stations_top)
+{
+    DataProvider dataProvider("../../data/", "ghcnd-stations_gm.txt", "ghcnd-inventory_gm.txt", ".csv");
+    const auto all = dataProvider.getNearestStations(49.47020, 10.99019, 300);
+    BOOST_REQUIRE_GT(all->size(), 20);
+
+    for (std::size_t top : {1u, 3u, 20u}) {
+        const auto nearest = dataProvider.getNearestStations(49.47020, 10.99019, 300, top);
+        BOOST_REQUIRE_EQUAL(nearest->size(), top);
+        BOOST_CHECK(std::equal(nearest->begin(), nearest->end(), all->begin()));
+    }
+    // More than there are within the radius: all of them.
+    BOOST_CHECK(*dataProvider.getNearestStations(49.47020, 10.99019, 300, all->size() + 5) == *all);
+}
+
+BOOST_AUTO_TEST_CASE(api_nearest_stations_with_coverage)
+{
+    DataProvider dataProvider("../../data/", "ghcnd-stations_gm.txt", "ghcnd-inventory_gm.txt", ".csv");
+    const auto all = dataProvider.getNearestStations(49.47020, 10.99019, 300);
+    std::vector<std::pair<std::string, double>> expected;
+    for (const auto& station : *all) {
+        if (dataProvider.hasMeasurementsForYearRange(station.first, 1960, 2023, MeasurementType::TMAX) &&
+            dataProvider.hasMeasurementsForYearRange(station.first, 1960, 2023, MeasurementType::TMIN)) {
+            expected.push_back(station);
+        }
+    }
+    BOOST_REQUIRE_GT(expected.size(), 3);
+    BOOST_REQUIRE_LT(expected.size(), all->size());
+
+    const std::vector<MeasurementType> required{MeasurementType::TMAX, MeasurementType::TMIN};
+    BOOST_CHECK(*dataProvider.getNearestStations(49.47020, 10.99019, 300, 0, 1960, 2023, required) == expected);
+    const auto top3 = dataProvider.getNearestStations(49.47020, 10.99019, 300, 3, 1960, 2023, required);
+    BOOST_REQUIRE_EQUAL(top3->size(), 3);
+    BOOST_CHECK(std::equal(top3->begin(), top3->end(), expected.begin()));
+    BOOST_CHECK(*dataProvider.getNearestStations(49.47020, 10.99019, 300, 1000, 1960, 2023, required) == expected);
+    BOOST_CHECK(dataProvider.getNearestStations(49.47020, 10.99019, 300, 5, 1700, 2023, required)->empty());
+}
+
+BOOST_AUTO_TEST_CASE(api_complete_measurements)
+{
+    const std::string stationId{"GME00102380"};
+    DataProvider dataProvider("../../data/", "ghcnd-stations_gm.txt", "ghcnd-inventory_gm.txt", ".csv");
+    BOOST_REQUIRE(dataProvider.preloadMeasurements(stationId, MeasurementFilter::all()));
+
+    // Bitmaps agree with the measurements: at most one per day in the station files.
+    std::size_t days{0};
+    for (int month = 1; month <= 12; ++month) {
+        days += dataProvider.getDailyValues(stationId, 1980, month, MeasurementType::TMAX)->size();
+    }
+    BOOST_REQUIRE_GT(days, 0);
+    BOOST_CHECK(dataProvider.hasCompleteMeasurements(stationId, 1980, 1980, MeasurementType::TMAX, (days - 0.5) / 366));
+    BOOST_CHECK(!dataProvider.hasCompleteMeasurements(stationId, 1980, 1980, MeasurementType::TMAX, (days + 0.5) / 366));
+    BOOST_CHECK(dataProvider.hasCompleteMeasurements(stationId, 1960, 2000, MeasurementType::TMAX, 0.0));
+    BOOST_CHECK(!dataProvider.hasCompleteMeasurements(stationId, 1700, 1700, MeasurementType::TMAX, 0.5));
+    BOOST_CHECK(!dataProvider.hasCompleteMeasurements("no station", 1960, 2000, MeasurementType::TMAX, 0.0));
+}
+
 BOOST_AUTO_TEST_CASE(api_yearly_averages)
 {
     const std::string stationId{"GME00102380"};
@@ -71,7 +174,6 @@ BOOST_AUTO_TEST_CASE(api_yearly_averages_month_span)
     auto yearlyAverages_9_11 = dataProvider.getAveragesForMonthRange(stationId, 1960, 2000, 9, 11, MeasurementType::TMAX);
     BOOST_CHECK_EQUAL(std::format("{:.1f}", (*yearlyAverages_9_11)[1960]), "14.0");
     BOOST_CHECK_EQUAL(std::format("{:.1f}", (*yearlyAverages_9_11)[2000]), "14.5");
-
 }
 
 BOOST_AUTO_TEST_CASE(api_montly_averages)
@@ -104,3 +206,848 @@ BOOST_AUTO_TEST_CASE(api_daily_values)
 }
 
 BOOST_AUTO_TEST_SUITE_END()  // public_api
+
+BOOST_AUTO_TEST_SUITE(parser)
+
+BOOST_AUTO_TEST_CASE(parser_parallel_equals_sequential)
+{
+    std::string text;
+    for (int year = 1950; year <= 2000; ++year) {
+        for (int day = 1; day <= 28; ++day) {
+            text += std::format("GME00102380,{:04d}01{:02d},TMAX,{},,,E,\n", year, day, year - day);
+            text += std::format("GME00102380,{:04d}01{:02d},TMIN,{},,,E,\n", year, day, day - year);
+        }
+    }
+    text += "malformed line\n";
+    text += "GME00102380,20010101,PRCP,7";  // no trailing line break
+
+    std::vector<Measurement> sequential;
+    MeasurementParser::parseCsv(text, sequential);
+    BOOST_CHECK_EQUAL(sequential.size(), 51 * 28 * 2 + 1);
+
+    for (unsigned numChunks : {2u, 3u, 7u, 64u}) {
+        std::vector<Measurement> parallel;
+        MeasurementParser::parseParallel(text, parallel, numChunks);
+        BOOST_REQUIRE_EQUAL(parallel.size(), sequential.size());
+        for (std::size_t i = 0; i < sequential.size(); ++i) {
+            BOOST_CHECK(parallel[i].getYear() == sequential[i].getYear() &&
+                        parallel[i].getMonth() == sequential[i].getMonth() &&
+                        parallel[i].getDay() == sequential[i].getDay() &&
+                        parallel[i].getValue() == sequential[i].getValue() &&
+                        parallel[i].getType() == sequential[i].getType());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(parser_dly_layout)
+{
+    // One station-month per line: 11 + 4 + 2 + 4 columns, then 31 slots of value (5) and three flags.
+    auto dlyLine = [](int year, int month, std::string_view element, auto valueOfDay) {
+        std::string line = std::format("GME00102380{:04}{:02}{}", year, month, element);
+        for (int day = 1; day <= 31; ++day) {
+            line += std::format("{:>5}  E", valueOfDay(day));
+        }
+        return line + "\n";
+    };
+    std::string text;
+    text += dlyLine(1960, 2, "TMAX", [](int day) {return day <= 29 ? day * 10 - 100 : -9999;});  // Leap year
+    text += dlyLine(1960, 2, "WT03", [](int day) {return day == 3 ? 1 : -9999;});
+    text += dlyLine(1960, 2, "XXXX", [](int day) {return day;});                                // Unknown element
+    text += "GME00102380196003TMAX    1  E";                                                     // Truncated line
+    text += "\n" + dlyLine(1960, 3, "TMIN", [](int day) {return day == 31 ? -5 : -9999;});
+
+    BOOST_CHECK(MeasurementParser::formatForFilename("GME00102380.dly") == MeasurementParser::Format::DLY);
+    BOOST_CHECK(MeasurementParser::formatForFilename("GME00102380.dly.gz") == MeasurementParser::Format::DLY);
+    BOOST_CHECK(MeasurementParser::formatForFilename("GME00102380.csv.gz") == MeasurementParser::Format::CSV);
+
+    std::vector<Measurement> measurements;
+    BOOST_CHECK_EQUAL(MeasurementParser::parseDly(text, measurements), 29 + 1 + 1);
+    BOOST_REQUIRE_EQUAL(measurements.size(), 31);
+    BOOST_CHECK(measurements[0].getType() == MeasurementType::TMAX);
+    BOOST_CHECK_EQUAL(measurements[0].getValue(), -90);
+    BOOST_CHECK_EQUAL(measurements[28].getDay(), 29);
+    BOOST_CHECK_EQUAL(measurements[28].getValue(), 190);
+    BOOST_CHECK(measurements[29].getType() == MeasurementType::WT03);
+    BOOST_CHECK_EQUAL(measurements[29].getDay(), 3);
+    BOOST_CHECK_EQUAL(measurements[30].getMonth(), 3);
+    BOOST_CHECK_EQUAL(measurements[30].getDay(), 31);
+    BOOST_CHECK_EQUAL(measurements[30].getValue(), -5);
+
+    std::vector<Measurement> parallel;
+    MeasurementParser::parseParallel(text, parallel, 3, MeasurementParser::Format::DLY);
+    BOOST_CHECK_EQUAL(parallel.size(), measurements.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // parser
+
+BOOST_AUTO_TEST_SUITE(binary_cache)
+
+BOOST_FIXTURE_TEST_CASE(binary_cache_roundtrip_and_invalidation, TempDir)
+{
+    const std::string source = (dir / "GMTEST000001.csv").string();
+    const std::string cache = BinaryCache::cacheFilenameFor(source);
+
+    std::string text{"GMTEST000001,19600101,TMAX,12,,,E,\nGMTEST000001,19600101,TMIN,-34,,,E,\nGMTEST000001,20231231,PRCP,5,,,E,\n"};
+    std::ofstream(source, std::ios::binary) << text;
+
+    std::vector<Measurement> parsed;
+    MeasurementParser::parseCsv(text, parsed);
+    const StationMeasurements expected(parsed);
+    BOOST_REQUIRE(BinaryCache::write(cache, source, expected));
+
+    StationMeasurements actual;
+    BOOST_REQUIRE(BinaryCache::read(cache, source, actual));
+    BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+    for (MeasurementType type : {MeasurementType::PRCP, MeasurementType::TMAX, MeasurementType::TMIN}) {
+        auto expectedSeries = expected.series(type);
+        auto actualSeries = actual.series(type);
+        BOOST_REQUIRE_EQUAL(actualSeries.size(), expectedSeries.size());
+        for (std::size_t i = 0; i < expectedSeries.size(); ++i) {
+            BOOST_CHECK(actualSeries[i].getPackedDate() == expectedSeries[i].getPackedDate() &&
+                        actualSeries[i].getValue() == expectedSeries[i].getValue() &&
+                        actualSeries[i].getType() == expectedSeries[i].getType());
+        }
+    }
+
+    // Filtered: only the selected years of the selected types.
+    const MeasurementFilter tmax1960({MeasurementType::TMAX}, 1960, 1960);
+    StationMeasurements filtered;
+    BOOST_REQUIRE(BinaryCache::read(cache, source, filtered, &tmax1960));
+    BOOST_CHECK_EQUAL(filtered.size(), 1);
+    BOOST_CHECK_EQUAL(filtered.series(MeasurementType::TMAX).size(), 1);
+    const MeasurementFilter later({MeasurementType::TMAX, MeasurementType::PRCP}, 1961, 2100);
+    BOOST_REQUIRE(BinaryCache::read(cache, source, filtered, &later));
+    BOOST_CHECK_EQUAL(filtered.size(), 1);
+    BOOST_CHECK_EQUAL(filtered.series(MeasurementType::PRCP).size(), 1);
+
+    // Touched only => same size, other time, same hash: still valid.
+    std::filesystem::last_write_time(source, std::filesystem::last_write_time(source) + std::chrono::seconds(10));
+    BOOST_CHECK(BinaryCache::read(cache, source, actual));
+
+    // Same size, other content and time => stale.
+    text[text.find(",12,") + 2] = '3';  // TMAX 12 => 13
+    std::ofstream(source, std::ios::binary) << text;
+    std::filesystem::last_write_time(source, std::filesystem::last_write_time(source) + std::chrono::seconds(20));
+    BOOST_CHECK(!BinaryCache::read(cache, source, actual));
+
+    // Changed size => stale.
+    std::ofstream(source, std::ios::binary | std::ios::app) << "GMTEST000001,20240101,PRCP,1,,,E,\n";
+    BOOST_CHECK(!BinaryCache::read(cache, source, actual));
+
+    // Same size, value changed in the middle of a large file => stale as well.
+    std::string large;
+    for (int i = 0; large.size() < 1024 * 1024; ++i) {
+        large += std::format("GMTEST000001,{:04}{:02}{:02},TMAX,{:>4},,,E,\n", 1900 + i / 372, 1 + i / 31 % 12, 1 + i % 31, i % 1000);
+    }
+    std::ofstream(source, std::ios::binary | std::ios::trunc) << large;
+    parsed.clear();
+    MeasurementParser::parseCsv(large, parsed);
+    BOOST_REQUIRE(BinaryCache::write(cache, source, StationMeasurements(parsed)));
+    BOOST_REQUIRE(BinaryCache::read(cache, source, actual));
+    const std::size_t middle = large.find(",TMAX,", large.size() / 2) + 6;
+    large[middle] = large[middle] == '9' ? '8' : '9';
+    std::ofstream(source, std::ios::binary | std::ios::trunc) << large;
+    std::filesystem::last_write_time(source, std::filesystem::last_write_time(source) + std::chrono::seconds(30));
+    BOOST_CHECK(!BinaryCache::read(cache, source, actual));
+}
+
+BOOST_FIXTURE_TEST_CASE(binary_cache_completeness_bitmaps, TempDir)
+{
+    const std::string source = (dir / "GMTEST000002.csv").string();
+    const std::string cache = BinaryCache::cacheFilenameFor(source);
+
+    // TMAX: 1960 (leap year) complete, 1961 without December, 1962 missing, 1963 on the 1st of each month.
+    std::vector<Measurement> rows;
+    const int daysInMonth[] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    for (int year : {1960, 1961}) {
+        for (int month = 1; month <= (year == 1961 ? 11 : 12); ++month) {
+            for (int day = 1; day <= daysInMonth[month - 1] - (month == 2 && year != 1960 ? 1 : 0); ++day) {
+                rows.emplace_back(year, month, day, 100, MeasurementType::TMAX);
+            }
+        }
+    }
+    for (int month = 1; month <= 12; ++month) {
+        rows.emplace_back(1963, month, 1, 100, MeasurementType::TMAX);
+    }
+    rows.emplace_back(1961, 2, 28, 5, MeasurementType::PRCP);
+    std::ofstream(source, std::ios::binary) << "GMTEST000002,19600101,TMAX,100,,,E,\n";
+    BOOST_REQUIRE(BinaryCache::write(cache, source, StationMeasurements(rows)));
+
+    DataCompleteness completeness;
+    BOOST_REQUIRE(BinaryCache::readCompleteness(cache, source, completeness));
+    BOOST_CHECK_EQUAL(completeness.daysWithData(MeasurementType::TMAX, 1959), 0);
+    BOOST_CHECK_EQUAL(completeness.daysWithData(MeasurementType::TMAX, 1960), 366);
+    BOOST_CHECK_EQUAL(completeness.daysWithData(MeasurementType::TMAX, 1961), 334);
+    BOOST_CHECK_EQUAL(completeness.daysWithData(MeasurementType::TMAX, 1962), 0);
+    BOOST_CHECK_EQUAL(completeness.daysWithData(MeasurementType::TMAX, 1963), 12);
+    BOOST_CHECK_EQUAL(completeness.daysWithData(MeasurementType::PRCP, 1961), 1);
+    BOOST_CHECK_EQUAL(completeness.daysWithData(MeasurementType::TMIN, 1961), 0);
+
+    BOOST_CHECK(completeness.isComplete(MeasurementType::TMAX, 1960, 1960, 1.0));
+    BOOST_CHECK(completeness.isComplete(MeasurementType::TMAX, 1960, 1961, 0.9));   // 334 of 365 days
+    BOOST_CHECK(!completeness.isComplete(MeasurementType::TMAX, 1960, 1961, 0.95));
+    BOOST_CHECK(!completeness.isComplete(MeasurementType::TMAX, 1960, 1963, 0.01));  // Gap in 1962
+    BOOST_CHECK(!completeness.isComplete(MeasurementType::TMIN, 1960, 1960, 0.5));
+
+    // Stale sidecar: no bitmaps either.
+    std::ofstream(source, std::ios::binary | std::ios::app) << "GMTEST000002,19600102,TMAX,100,,,E,\n";
+    BOOST_CHECK(!BinaryCache::readCompleteness(cache, source, completeness));
+}
+
+BOOST_FIXTURE_TEST_CASE(binary_cache_monthly_aggregates, TempDir)
+{
+    const std::string source = (dir / "GMTEST000003.csv").string();
+    const std::string cache = BinaryCache::cacheFilenameFor(source);
+
+    // TMAX on three days of every month 1960-1969 except 1965, TMIN only in 1962.
+    std::vector<Measurement> rows;
+    for (int year = 1960; year <= 1969; ++year) {
+        for (int month = 1; month <= 12 && year != 1965; ++month) {
+            for (int day : {1, 10, 20}) {
+                rows.emplace_back(year, month, day, year - 1960 + month * day, MeasurementType::TMAX);
+            }
+        }
+    }
+    rows.emplace_back(1962, 7, 4, -15, MeasurementType::TMIN);
+    const StationMeasurements measurements(rows);
+    std::ofstream(source, std::ios::binary) << "GMTEST000003,19600101,TMAX,1,,,E,\n";
+    BOOST_REQUIRE(BinaryCache::write(cache, source, measurements));
+
+    MonthlyAggregates aggregates;
+    BOOST_REQUIRE(BinaryCache::readAggregates(cache, source, aggregates));
+    BOOST_CHECK_EQUAL(aggregates.firstYear(MeasurementType::TMAX), 1960);
+    BOOST_CHECK_EQUAL(aggregates.lastYear(MeasurementType::TMAX), 1969);
+    BOOST_CHECK(aggregates.firstYear(MeasurementType::PRCP) > aggregates.lastYear(MeasurementType::PRCP));
+
+    // Same windows as StationMeasurements::range(), including clamping and the turn of the year.
+    const std::vector<std::array<int, 4>> windows{{1960, 1, 1969, 12}, {1962, 3, 1962, 5}, {1964, 12, 1966, 2},
+                                                  {1965, 1, 1965, 12}, {1900, 1, 1961, 6}, {1968, 6, 2023, 12}, {1970, 1, 1980, 12}};
+    for (MeasurementType type : {MeasurementType::TMAX, MeasurementType::TMIN, MeasurementType::PRCP}) {
+        for (const auto& [startYear, startMonth, endYear, endMonth] : windows) {
+            const auto range = measurements.range(type, startYear, startMonth, endYear, endMonth);
+            const MonthlyAggregates::Total total = aggregates.total(type, startYear, startMonth, endYear, endMonth);
+            std::int64_t sum{0};
+            for (const Measurement& m : range) {
+                sum += m.getValue();
+            }
+            BOOST_CHECK_EQUAL(total.count, range.size());
+            BOOST_CHECK_EQUAL(total.sum, sum);
+        }
+    }
+
+    // Changed source => no aggregates either.
+    std::ofstream(source, std::ios::binary | std::ios::app) << "GMTEST000003,19600102,TMAX,1,,,E,\n";
+    BOOST_CHECK(!BinaryCache::readAggregates(cache, source, aggregates));
+}
+
+BOOST_FIXTURE_TEST_CASE(binary_cache_aggregates_across_sessions, TempDir)
+{
+    // TMAX 1990-1999, two days per month.
+    std::string text;
+    for (int year = 1990; year <= 1999; ++year) {
+        for (int month = 1; month <= 12; ++month) {
+            for (int day : {1, 15}) {
+                text += std::format("GMTEST000001,{}{:02}{:02},TMAX,{},,,E,\n", year, month, day, year - 1900 + month * day);
+            }
+        }
+    }
+    std::ofstream(dir / "stations.txt") << std::format("{:<11} {:>8.4f} {:>9.4f} {:>6.1f}    {:<30}\n",
+                                                       "GMTEST000001", 49.4702, 10.9902, 300.0, "TEST");
+    std::ofstream(dir / "inventory.txt") << "";
+    std::ofstream(dir / "GMTEST000001.csv", std::ios::binary) << text;
+    const std::string id{"GMTEST000001"};
+
+    // First session: the station file is parsed once, the sidecar is written with the aggregates.
+    std::unique_ptr<std::map<int, float>> first;
+    {
+        DataProvider dataProvider(dir.string() + "/", "stations.txt", "inventory.txt", ".csv");
+        first = dataProvider.getYearlyAverages(id, 1992, 1995, MeasurementType::TMAX);
+        BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().misses, 1);
+    }
+    BOOST_REQUIRE_EQUAL(first->size(), 4);
+    const std::string source = (dir / "GMTEST000001.csv").string();
+    MonthlyAggregates aggregates;
+    BOOST_REQUIRE(BinaryCache::readAggregates(BinaryCache::cacheFilenameFor(source), source, aggregates));
+    BOOST_CHECK_EQUAL(aggregates.lastYear(MeasurementType::TMAX), 1999);
+
+    // Second session: served from the aggregates in the sidecar. No measurements are loaded, so no lookup is counted.
+    DataProvider dataProvider(dir.string() + "/", "stations.txt", "inventory.txt", ".csv");
+    BOOST_CHECK(*dataProvider.getYearlyAverages(id, 1992, 1995, MeasurementType::TMAX) == *first);
+    BOOST_CHECK_EQUAL(dataProvider.getAveragesForMonthRange(id, 1992, 1995, 12, 2, MeasurementType::TMAX)->size(), 4);
+    BOOST_CHECK_EQUAL(dataProvider.getMonthlyAverages(id, 1999, MeasurementType::TMAX)->size(), 12);
+    BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().hits, 0);
+    BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().misses, 0);
+    BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().entries, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // binary_cache
+
+BOOST_AUTO_TEST_SUITE(station_measurements)
+
+BOOST_AUTO_TEST_CASE(station_measurements_range_lookup)
+{
+    // TMAX on the 1st and 15th of every month 1960-1969, 1965 missing. PRCP only in 1970.
+    std::vector<Measurement> rows;
+    for (int year = 1960; year <= 1969; ++year) {
+        for (int month = 1; month <= 12 && year != 1965; ++month) {
+            rows.emplace_back(year, month, 1, month, MeasurementType::TMAX);
+            rows.emplace_back(year, month, 15, month, MeasurementType::TMAX);
+        }
+    }
+    rows.emplace_back(1970, 6, 1, 42, MeasurementType::PRCP);
+    const StationMeasurements measurements(rows);
+
+    BOOST_CHECK_EQUAL(measurements.firstYear(MeasurementType::TMAX), 1960);
+    BOOST_CHECK_EQUAL(measurements.lastYear(MeasurementType::TMAX), 1969);
+    BOOST_CHECK_EQUAL(measurements.series(MeasurementType::PRCP).size(), 1);
+    BOOST_CHECK(measurements.series(MeasurementType::SNOW).empty());
+
+    BOOST_CHECK_EQUAL(measurements.yearRange(MeasurementType::TMAX, 1960, 1969).size(), 9 * 24);
+    BOOST_CHECK_EQUAL(measurements.yearRange(MeasurementType::TMAX, 1962, 1962).size(), 24);
+    BOOST_CHECK(measurements.yearRange(MeasurementType::TMAX, 1965, 1965).empty());
+
+    // Missing start or end year does not empty the range, it is clamped to the available years.
+    BOOST_CHECK_EQUAL(measurements.yearRange(MeasurementType::TMAX, 1900, 2023).size(), 9 * 24);
+    BOOST_CHECK_EQUAL(measurements.yearRange(MeasurementType::TMAX, 1965, 1966).size(), 24);
+    BOOST_CHECK(measurements.yearRange(MeasurementType::TMAX, 1900, 1950).empty());
+
+    // Month window over the year boundary.
+    auto winter = measurements.range(MeasurementType::TMAX, 1960, 12, 1961, 2);
+    BOOST_REQUIRE_EQUAL(winter.size(), 6);
+    BOOST_CHECK_EQUAL(winter.front().getMonth(), 12);
+    BOOST_CHECK_EQUAL(winter.back().getMonth(), 2);
+    BOOST_CHECK_EQUAL(winter.back().getDay(), 15);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // station_measurements
+
+BOOST_AUTO_TEST_SUITE(measurements_cache)
+
+// One year of daily TMAX, the same size for every station.
+static std::unique_ptr<StationMeasurements>
+makeStation()
+{
+    std::vector<Measurement> rows;
+    for (int day = 1; day <= 365; ++day) {
+        rows.emplace_back(1990, (day - 1) / 31 + 1, (day - 1) % 31 + 1, day, MeasurementType::TMAX);
+    }
+    return std::make_unique<StationMeasurements>(rows);
+}
+
+BOOST_AUTO_TEST_CASE(measurements_cache_evicts_least_recently_used)
+{
+    const std::size_t stationBytes = makeStation()->memoryUsage() + MeasurementsCache::entryOverhead();
+    BOOST_REQUIRE_GT(stationBytes, 365 * sizeof(Measurement));
+    BOOST_REQUIRE_GT(MeasurementsCache::entryOverhead(), sizeof(MeasurementFilter));
+
+    const MeasurementFilter tmax({MeasurementType::TMAX}, 1990, 1990);
+    const StationKey a("GMTEST00001"), b("GMTEST00002"), c("GMTEST00003"), d("GMTEST00004");
+    MeasurementsCache cache(3 * stationBytes);
+    cache.insert(a, makeStation(), tmax);
+    cache.insert(b, makeStation(), tmax);
+    cache.insert(c, makeStation(), tmax);
+    BOOST_CHECK_EQUAL(cache.statistics().bytes, 3 * stationBytes);
+    BOOST_CHECK_EQUAL(cache.statistics().evictions, 0);
+
+    // a is used again, so b is the least recently used one when d arrives.
+    BOOST_CHECK(cache.lookup(a, tmax) != nullptr);
+    BOOST_CHECK(cache.lookup(a, MeasurementFilter({MeasurementType::TMIN}, 1990, 1990)) == nullptr);  // Not covered
+    cache.insert(d, makeStation(), tmax);
+    BOOST_CHECK(cache.coverage(b) == nullptr);
+    BOOST_CHECK(cache.lookup(b, tmax) == nullptr);
+    BOOST_CHECK(cache.lookup(a, tmax) != nullptr);
+    BOOST_CHECK(cache.lookup(c, tmax) != nullptr);
+    BOOST_CHECK(cache.lookup(d, tmax) != nullptr);
+
+    const MeasurementsCache::Statistics& statistics = cache.statistics();
+    BOOST_CHECK_EQUAL(statistics.hits, 4);
+    BOOST_CHECK_EQUAL(statistics.misses, 2);
+    BOOST_CHECK_EQUAL(statistics.evictions, 1);
+    BOOST_CHECK_EQUAL(statistics.entries, 3);
+    BOOST_CHECK_EQUAL(statistics.bytes, 3 * stationBytes);
+
+    // Replacing an entry does not count twice. A budget below one station keeps the most recent one.
+    cache.insert(d, makeStation(), tmax);
+    BOOST_CHECK_EQUAL(cache.statistics().bytes, 3 * stationBytes);
+    cache.setByteBudget(1);
+    BOOST_CHECK_EQUAL(cache.statistics().entries, 1);
+    BOOST_CHECK(cache.coverage(d) != nullptr);
+    BOOST_CHECK_EQUAL(cache.statistics().evictions, 3);
+}
+
+BOOST_AUTO_TEST_CASE(measurements_cache_keeps_oversize_entry_until_next_insert)
+{
+    const std::size_t stationBytes = makeStation()->memoryUsage() + MeasurementsCache::entryOverhead();
+    const MeasurementFilter tmax({MeasurementType::TMAX}, 1990, 1990);
+    const StationKey a("GMTEST00001"), b("GMTEST00002");
+    MeasurementsCache cache(stationBytes / 2);
+
+    // Larger than the budget, but kept: the caller uses it right after insert().
+    const StationMeasurements& inserted = cache.insert(a, makeStation(), tmax);
+    BOOST_CHECK_EQUAL(inserted.size(), 365);
+    BOOST_CHECK_EQUAL(cache.statistics().entries, 1);
+    BOOST_CHECK_EQUAL(cache.statistics().bytes, stationBytes);
+    BOOST_CHECK_GT(cache.statistics().bytes, cache.byteBudget());
+    BOOST_CHECK_EQUAL(cache.statistics().evictions, 0);
+    BOOST_CHECK(cache.lookup(a, tmax) != nullptr);
+
+    // The next insert evicts it, the new station is over budget in turn.
+    cache.insert(b, makeStation(), tmax);
+    BOOST_CHECK(cache.coverage(a) == nullptr);
+    BOOST_CHECK(cache.lookup(b, tmax) != nullptr);
+    BOOST_CHECK_EQUAL(cache.statistics().entries, 1);
+    BOOST_CHECK_EQUAL(cache.statistics().evictions, 1);
+    BOOST_CHECK_EQUAL(cache.statistics().bytes, stationBytes);
+}
+
+BOOST_AUTO_TEST_CASE(measurements_cache_charges_and_evicts_summaries)
+{
+    const MeasurementFilter tmax({MeasurementType::TMAX}, 1990, 1990);
+    const StationKey a("GMTEST00001"), b("GMTEST00002");
+    MeasurementsCache cache;
+
+    // Summaries without measurements: charged, not counted as lookups.
+    const auto station = makeStation();
+    const StationMeasurements& measurements = *station;
+    const std::size_t completenessBytes = DataCompleteness(measurements).memoryUsage();
+    cache.insertCompleteness(a, std::make_unique<DataCompleteness>(measurements));
+    BOOST_CHECK_EQUAL(cache.statistics().bytes, MeasurementsCache::entryOverhead() + completenessBytes);
+    BOOST_CHECK(cache.completeness(a) != nullptr);
+    BOOST_CHECK(cache.completeness(b) == nullptr);
+    BOOST_CHECK(cache.coverage(a) == nullptr);
+    BOOST_CHECK(cache.lookup(a, tmax) == nullptr);
+    BOOST_CHECK_EQUAL(cache.statistics().hits, 0);
+    BOOST_CHECK_EQUAL(cache.statistics().misses, 1);
+
+    // Aggregates of selected measurements serve covered queries only and go with the measurements.
+    cache.insert(a, makeStation(), tmax);
+    cache.insertAggregates(a, std::make_unique<MonthlyAggregates>(cache.at(a)), false);
+    BOOST_CHECK(cache.aggregates(a, tmax) != nullptr);
+    BOOST_CHECK(cache.aggregates(a, MeasurementFilter({MeasurementType::TMAX}, 1989, 1990)) == nullptr);
+    cache.insert(a, makeStation(), MeasurementFilter({MeasurementType::TMAX}, 1980, 1990));
+    BOOST_CHECK(cache.aggregates(a, tmax) == nullptr);
+    // Complete aggregates serve everything and stay.
+    cache.insertAggregates(a, std::make_unique<MonthlyAggregates>(cache.at(a)), true);
+    cache.insert(a, makeStation(), tmax);
+    BOOST_CHECK(cache.aggregates(a, MeasurementFilter::all()) != nullptr);
+    BOOST_CHECK(cache.completeness(a) != nullptr);
+    BOOST_CHECK_EQUAL(cache.statistics().entries, 1);
+
+    // All parts of a station are evicted together.
+    cache.setByteBudget(cache.statistics().bytes);
+    cache.insertCompleteness(b, std::make_unique<DataCompleteness>(measurements));
+    BOOST_CHECK_EQUAL(cache.statistics().entries, 1);
+    BOOST_CHECK(cache.completeness(a) == nullptr);
+    BOOST_CHECK(cache.aggregates(a, tmax) == nullptr);
+    BOOST_CHECK_EQUAL(cache.statistics().bytes, MeasurementsCache::entryOverhead() + completenessBytes);
+}
+
+BOOST_FIXTURE_TEST_CASE(measurements_cache_in_data_provider, TempDir)
+{
+    // Second station: a copy of the first one under another ID.
+    for (const char* name : {"ghcnd-stations_gm.txt", "ghcnd-inventory_gm.txt"}) {
+        std::filesystem::copy_file(std::filesystem::path("../../data") / name, dir / name);
+    }
+    std::filesystem::copy_file("../../data/GME00102380_2024-05-31.csv", dir / "GME00102380.csv");
+    std::filesystem::copy_file("../../data/GME00102380_2024-05-31.csv", dir / "GME00111445.csv");
+
+    DataProvider dataProvider(dir.string() + "/", "ghcnd-stations_gm.txt", "ghcnd-inventory_gm.txt", ".csv");
+    dataProvider.setCacheByteBudget(1);  // Keeps only the station used last
+    // Daily values need the measurements. Averages are served from MonthlyAggregates and do not use this cache.
+    BOOST_REQUIRE(!dataProvider.getDailyValues("GME00102380", 1980, 6, MeasurementType::TMAX)->empty());
+    BOOST_REQUIRE(!dataProvider.getDailyValues("GME00102380", 1980, 7, MeasurementType::TMAX)->empty());
+    BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().hits, 1);
+    BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().misses, 1);
+
+    BOOST_REQUIRE(!dataProvider.getDailyValues("GME00111445", 1980, 6, MeasurementType::TMAX)->empty());
+    BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().evictions, 1);
+    BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().entries, 1);
+    // Evicted station is loaded again, with the same result.
+    const auto reloaded = dataProvider.getDailyValues("GME00102380", 1980, 6, MeasurementType::TMAX);
+    BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().misses, 3);
+    BOOST_CHECK(!reloaded->empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // measurements_cache
+
+BOOST_AUTO_TEST_SUITE(measurement_filter)
+
+BOOST_FIXTURE_TEST_CASE(measurement_filter_push_down_and_top_up, TempDir)
+{
+    MeasurementFilter tmax({MeasurementType::TMAX}, 1961, 1962);
+    BOOST_CHECK(tmax.accepts(MeasurementType::TMAX, 1961));
+    BOOST_CHECK(!tmax.accepts(MeasurementType::TMAX, 1963));
+    BOOST_CHECK(!tmax.accepts(MeasurementType::TMIN, 1961));
+    BOOST_CHECK(MeasurementFilter::all().covers(tmax));
+    BOOST_CHECK(!tmax.covers(MeasurementFilter({MeasurementType::TMAX}, 1960, 1962)));
+    MeasurementFilter wider = tmax;
+    wider.add(MeasurementType::TMAX, 1965, 1966);  // Widened to 1961-1966
+    BOOST_CHECK(wider.covers(MeasurementFilter({MeasurementType::TMAX}, 1963, 1964)));
+    BOOST_CHECK(!wider.acceptsAll());
+
+    // TMAX and TMIN, 1960-1969, two days per month.
+    std::string text;
+    for (int year = 1960; year <= 1969; ++year) {
+        for (int month = 1; month <= 12; ++month) {
+            for (int day : {1, 15}) {
+                text += std::format("GMTEST000001,{}{:02}{:02},TMAX,{},,,E,\n", year, month, day, year - 1900);
+                text += std::format("GMTEST000001,{}{:02}{:02},TMIN,{},,,E,\n", year, month, day, 1900 - year);
+            }
+        }
+    }
+    std::vector<Measurement> measurements;
+    MeasurementParser::parseCsv(text, measurements, &tmax);
+    BOOST_REQUIRE_EQUAL(measurements.size(), 2 * 24);
+    BOOST_CHECK(std::ranges::all_of(measurements, [](const Measurement& m) {
+        return m.getType() == MeasurementType::TMAX && m.getYear() >= 1961 && m.getYear() <= 1962;
+    }));
+
+    // Through DataProvider. Without a sidecar, the first load parses the whole file and writes the sidecar.
+    std::ofstream(dir / "stations.txt") << std::format("{:<11} {:>8.4f} {:>9.4f} {:>6.1f}    {:<30}\n",
+                                                       "GMTEST000001", 49.4702, 10.9902, 300.0, "TEST");
+    std::ofstream(dir / "inventory.txt") << "";
+    std::ofstream(dir / "GMTEST000001.csv", std::ios::binary) << text;
+    const std::string id{"GMTEST000001"};
+    {
+        DataProvider dataProvider(dir.string() + "/", "stations.txt", "inventory.txt", ".csv");
+        BOOST_CHECK_EQUAL(dataProvider.getDailyValues(id, 1961, 6, MeasurementType::TMAX)->size(), 2);
+        BOOST_CHECK(std::filesystem::exists(dir / "GMTEST000001.ghcnbin"));
+        BOOST_CHECK_EQUAL(dataProvider.getDailyValues(id, 1969, 1, MeasurementType::TMIN)->size(), 2);  // All cached
+        BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().hits, 1);
+        BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().misses, 1);
+    }
+
+    // With the sidecar, each query copies its selection only. A query not covered by the cached selection
+    // loads both combined, so a wider query sees all its years and earlier data stays available.
+    DataProvider dataProvider(dir.string() + "/", "stations.txt", "inventory.txt", ".csv");
+
+    BOOST_CHECK_EQUAL(dataProvider.getDailyValues(id, 1961, 6, MeasurementType::TMAX)->size(), 2);  // Loads TMAX 1961
+    BOOST_CHECK_EQUAL(dataProvider.getDailyValues(id, 1961, 7, MeasurementType::TMAX)->size(), 2);
+    BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().hits, 1);
+    BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().misses, 1);
+    BOOST_CHECK_CLOSE(dataProvider.getDailyValues(id, 1965, 1, MeasurementType::TMAX)->at(15), 6.5f, 0.001);  // TMAX 1961-1965
+    BOOST_CHECK_EQUAL(dataProvider.getDailyValues(id, 1963, 3, MeasurementType::TMAX)->size(), 2);  // Enclosing window
+    BOOST_CHECK_CLOSE(dataProvider.getDailyValues(id, 1961, 6, MeasurementType::TMAX)->at(1), 6.1f, 0.001);  // Kept
+    BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().hits, 3);
+    BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().misses, 2);
+
+    BOOST_CHECK(dataProvider.preloadMeasurements(id, MeasurementFilter({MeasurementType::TMIN}, 1960, 1960)));  // Adds TMIN 1960
+    BOOST_CHECK_EQUAL(dataProvider.getDailyValues(id, 1962, 2, MeasurementType::TMAX)->size(), 2);
+    BOOST_CHECK_CLOSE(dataProvider.getDailyValues(id, 1960, 12, MeasurementType::TMIN)->at(1), -6.0f, 0.001);
+    BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().hits, 5);
+    BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().misses, 3);
+    BOOST_CHECK_CLOSE(dataProvider.getDailyValues(id, 1969, 1, MeasurementType::TMIN)->at(1), -6.9f, 0.001);
+    BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().misses, 4);
+    BOOST_CHECK(dataProvider.preloadMeasurements(id, MeasurementFilter({MeasurementType::TMAX, MeasurementType::TMIN}, 1962, 1964)));
+    BOOST_CHECK_EQUAL(dataProvider.cacheStatistics().hits, 6);
+
+    // Averages come from the aggregates in the sidecar.
+    BOOST_CHECK_EQUAL(dataProvider.getYearlyAverages("GMTEST000001", 1961, 1962, MeasurementType::TMAX)->size(), 2);
+    auto allYears = dataProvider.getYearlyAverages("GMTEST000001", 1900, 2000, MeasurementType::TMAX);
+    BOOST_REQUIRE_EQUAL(allYears->size(), 10);
+    BOOST_CHECK_CLOSE(allYears->at(1969), 6.9f, 0.001);
+    auto tmin = dataProvider.getYearlyAverages("GMTEST000001", 1965, 1965, MeasurementType::TMIN);
+    BOOST_REQUIRE_EQUAL(tmin->size(), 1);
+    BOOST_CHECK_CLOSE(tmin->at(1965), -6.5f, 0.001);
+    // Earlier selection is kept after the top-up.
+    BOOST_CHECK_EQUAL(dataProvider.getYearlyAverages("GMTEST000001", 1960, 1969, MeasurementType::TMAX)->size(), 10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // measurement_filter
+
+BOOST_AUTO_TEST_SUITE(inventory_index)
+
+BOOST_FIXTURE_TEST_CASE(inventory_index_year_range, TempDir)
+{
+    // Lines of a station not adjacent, second TMAX entry for the same station.
+    std::ofstream(dir / "stations.txt") << "";
+    std::ofstream(dir / "inventory.txt") << "GMTEST00002  49.4702   10.9902 TMAX 1950 1980\n"
+                                            "GMTEST00001  49.4702   10.9902 TMIN 1900 2023\n"
+                                            "GMTEST00002  49.4702   10.9902 TMIN 1960 2023\r\n"
+                                            "GMTEST00002  49.4702   10.9902 TMAX 1990 2023\n"
+                                            "GMTEST00003  49.4702   10.9902 TMAX 19xx 2023\n";
+    DataProvider dataProvider(dir.string() + "/", "stations.txt", "inventory.txt", ".csv");
+
+    BOOST_CHECK(dataProvider.hasMeasurementsForYearRange("GMTEST00001", 1960, 2023, MeasurementType::TMIN));
+    BOOST_CHECK(!dataProvider.hasMeasurementsForYearRange("GMTEST00001", 1960, 2023, MeasurementType::TMAX));
+    BOOST_CHECK(dataProvider.hasMeasurementsForYearRange("GMTEST00002", 1960, 2023, MeasurementType::TMIN));
+    BOOST_CHECK(dataProvider.hasMeasurementsForYearRange("GMTEST00002", 1960, 1970, MeasurementType::TMAX));
+    BOOST_CHECK(dataProvider.hasMeasurementsForYearRange("GMTEST00002", 2000, 2023, MeasurementType::TMAX));
+    BOOST_CHECK(!dataProvider.hasMeasurementsForYearRange("GMTEST00002", 1970, 2000, MeasurementType::TMAX));
+    BOOST_CHECK(!dataProvider.hasMeasurementsForYearRange("GMTEST00003", 2000, 2023, MeasurementType::TMAX));
+    BOOST_CHECK(!dataProvider.hasMeasurementsForYearRange("GMTEST00004", 2000, 2023, MeasurementType::TMAX));
+}
+
+BOOST_AUTO_TEST_CASE(inventory_index_ready_callback)
+{
+    std::atomic<int> calls{0};
+    DataProvider dataProvider("../../data/", "ghcnd-stations_gm.txt", "ghcnd-inventory_gm.txt", ".csv", [&calls]() {++calls;});
+    // Queries on stations or inventory wait for the readers.
+    BOOST_CHECK(dataProvider.hasMeasurementsForYearRange("GME00102380", 1960, 2023, MeasurementType::TMAX));
+    BOOST_CHECK(dataProvider.isReady());
+    BOOST_CHECK_EQUAL(calls.load(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // inventory_index
+
+BOOST_AUTO_TEST_SUITE(station_key)
+
+BOOST_AUTO_TEST_CASE(station_key_roundtrip_and_order)
+{
+    const std::vector<std::string> ids{"ACW00011604", "GM000001153", "GME00102380", "GME00102381", "USC00050848", "ZI000067983", "GM", "GMTEST000001"};
+    for (const std::string& id : ids) {
+        const StationKey key(id);
+        BOOST_REQUIRE(key.isValid());
+        BOOST_CHECK_EQUAL(key.toString(), id);
+    }
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        for (std::size_t j = 0; j < ids.size(); ++j) {
+            BOOST_CHECK_EQUAL(StationKey(ids[i]) < StationKey(ids[j]), ids[i] < ids[j]);
+        }
+    }
+    BOOST_CHECK(!StationKey("").isValid());
+    BOOST_CHECK(!StationKey("gme00102380").isValid());
+    BOOST_CHECK(!StationKey("GME 0102380").isValid());
+    BOOST_CHECK(!StationKey("GME001023800A").isValid());
+    BOOST_CHECK(StationKey() == StationKey("../etc"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // station_key
+
+BOOST_AUTO_TEST_SUITE(metadata_snapshot)
+
+BOOST_FIXTURE_TEST_CASE(metadata_snapshot_roundtrip_and_invalidation, TempDir)
+{
+    std::filesystem::copy_file("../../data/ghcnd-stations_gm.txt", dir / "stations.txt");
+    std::filesystem::copy_file("../../data/ghcnd-inventory_gm.txt", dir / "inventory.txt");
+    const std::string snapshotFilename = MetadataSnapshot::snapshotFilenameFor((dir / "stations.txt").string());
+
+    std::vector<std::pair<std::string, double>> parsed;
+    {
+        DataProvider dataProvider(dir.string() + "/", "stations.txt", "inventory.txt", ".csv");
+        parsed = *dataProvider.getNearestStations(49.49, 10.99, 100);
+    }
+    BOOST_REQUIRE(std::filesystem::exists(snapshotFilename));
+    BOOST_REQUIRE(!parsed.empty());
+
+    StationMetadata metadata;
+    BOOST_REQUIRE(MetadataSnapshot::read(snapshotFilename, (dir / "stations.txt").string(), (dir / "inventory.txt").string(), metadata));
+    BOOST_CHECK_EQUAL(metadata.stationCount(), 1124);
+    BOOST_CHECK_EQUAL(metadata.inventorySize(), 4807);
+    BOOST_CHECK_EQUAL(metadata.key(1).toString(), "GM000001153");
+    BOOST_CHECK_EQUAL(metadata.name(1), "MUENSTER");
+    BOOST_CHECK_CLOSE(metadata.latitude(1), 51.9506, 1e-9);
+    BOOST_CHECK_EQUAL(metadata.inventory(StationKey("GME00102380")).size(), 5);
+    BOOST_CHECK(metadata.inventory(StationKey("XX000000000")).empty());
+
+    {
+        DataProvider dataProvider(dir.string() + "/", "stations.txt", "inventory.txt", ".csv");
+        BOOST_CHECK(*dataProvider.getNearestStations(49.49, 10.99, 100) == parsed);
+        BOOST_CHECK(dataProvider.hasMeasurementsForYearRange("GME00102380", 1960, 2023, MeasurementType::TMAX));
+    }
+
+    // Changed inventory => snapshot rejected, file parsed again.
+    std::ofstream(dir / "inventory.txt", std::ios::app) << "GMTEST00001  49.4702   10.9902 TMAX 1950 2023\n";
+    BOOST_CHECK(!MetadataSnapshot::read(snapshotFilename, (dir / "stations.txt").string(), (dir / "inventory.txt").string(), metadata));
+    {
+        DataProvider dataProvider(dir.string() + "/", "stations.txt", "inventory.txt", ".csv");
+        BOOST_CHECK(dataProvider.hasMeasurementsForYearRange("GMTEST00001", 1960, 2023, MeasurementType::TMAX));
+    }
+
+    // Truncated snapshot => rejected.
+    std::filesystem::resize_file(snapshotFilename, std::filesystem::file_size(snapshotFilename) / 2);
+    BOOST_CHECK(!MetadataSnapshot::read(snapshotFilename, (dir / "stations.txt").string(), (dir / "inventory.txt").string(), metadata));
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // metadata_snapshot
+
+BOOST_AUTO_TEST_SUITE(spatial_index)
+
+BOOST_AUTO_TEST_CASE(spatial_index_equals_brute_force)
+{
+    // Grid over the whole sphere: poles and date line included.
+    std::vector<double> latitudes;
+    std::vector<double> longitudes;
+    for (int lat = -90; lat <= 90; lat += 3) {
+        for (int lng = -180; lng < 180; lng += 7) {
+            latitudes.push_back(lat + 0.25 * (lng % 3));
+            longitudes.push_back(lng + 0.5);
+        }
+    }
+    const SpatialIndex index(latitudes, longitudes);
+    BOOST_REQUIRE_EQUAL(index.size(), latitudes.size());
+
+    auto chordDistance = [](double lat1, double lng1, double lat2, double lng2) {
+        // Monotonic in the great circle distance, enough to compare orders.
+        const double r = std::numbers::pi_v<double> / 180;
+        const double dx = std::cos(lat1 * r) * std::cos(lng1 * r) - std::cos(lat2 * r) * std::cos(lng2 * r);
+        const double dy = std::cos(lat1 * r) * std::sin(lng1 * r) - std::cos(lat2 * r) * std::sin(lng2 * r);
+        const double dz = std::sin(lat1 * r) - std::sin(lat2 * r);
+        return std::sqrt(dx * dx + dy * dy + dz * dz);
+    };
+    const std::vector<std::pair<double, double>> queries{{49.49, 10.99}, {89.9, 0.0}, {-90.0, 45.0}, {0.3, 179.9}, {-33.9, -179.8}};
+    for (const auto& [lat, lng] : queries) {
+        for (double radius : {1.0, 150.0, 400.0, 2500.0, 30000.0}) {
+            const double chord = 2 * std::sin(std::min(radius / SpatialIndex::s_earthRadius, std::numbers::pi_v<double>) / 2);
+            std::vector<std::uint32_t> expected;
+            for (std::uint32_t i = 0; i < latitudes.size(); ++i) {
+                if (chordDistance(lat, lng, latitudes[i], longitudes[i]) <= chord) {
+                    expected.push_back(i);
+                }
+            }
+            std::vector<std::uint32_t> found = index.withinRadius(lat, lng, radius);
+            std::ranges::sort(found);
+            BOOST_CHECK(found == expected);
+        }
+        const std::vector<std::uint32_t> nearest = index.nearest(lat, lng, 10, 1000);
+        BOOST_REQUIRE_EQUAL(nearest.size(), 10);
+        std::vector<std::uint32_t> all(latitudes.size());
+        std::iota(all.begin(), all.end(), 0u);
+        std::ranges::sort(all, {}, [&](std::uint32_t i) {return chordDistance(lat, lng, latitudes[i], longitudes[i]);});
+        for (std::size_t i = 0; i < nearest.size(); ++i) {
+            BOOST_CHECK_CLOSE(chordDistance(lat, lng, latitudes[nearest[i]], longitudes[nearest[i]]),
+                              chordDistance(lat, lng, latitudes[all[i]], longitudes[all[i]]), 1e-9);
+        }
+    }
+    BOOST_CHECK(index.nearest(0.0, 0.0, 5, 1.0).empty());  // Nothing within 1 km
+
+    // With a predicate: the nearest accepted points, not the accepted ones among the nearest.
+    auto even = [](std::uint32_t i) {return i % 2 == 0;};
+    const std::vector<std::uint32_t> nearestEven = index.nearest(49.49, 10.99, 10, 1000, even);
+    BOOST_REQUIRE_EQUAL(nearestEven.size(), 10);
+    BOOST_CHECK(std::ranges::all_of(nearestEven, even));
+    std::vector<std::uint32_t> allEven;
+    for (std::uint32_t i = 0; i < latitudes.size(); i += 2) {
+        allEven.push_back(i);
+    }
+    std::ranges::sort(allEven, {}, [&](std::uint32_t i) {return chordDistance(49.49, 10.99, latitudes[i], longitudes[i]);});
+    for (std::size_t i = 0; i < nearestEven.size(); ++i) {
+        BOOST_CHECK_CLOSE(chordDistance(49.49, 10.99, latitudes[nearestEven[i]], longitudes[nearestEven[i]]),
+                          chordDistance(49.49, 10.99, latitudes[allEven[i]], longitudes[allEven[i]]), 1e-9);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(distance_kernel_simd_equals_scalar)
+{
+    // Odd count: the SIMD path also has a scalar tail.
+    std::vector<double> x, y, z;
+    std::vector<std::uint32_t> ids;
+    for (std::uint32_t i = 0; i < 103; ++i) {
+        double coords[3];
+        SpatialIndex::toUnitVector(-89.0 + 1.7 * i, -179.0 + 3.4 * i, coords);
+        x.push_back(coords[0]);
+        y.push_back(coords[1]);
+        z.push_back(coords[2]);
+        ids.push_back(i);
+    }
+    double query[3];
+    SpatialIndex::toUnitVector(12.3, 45.6, query);
+
+    std::vector<double> distances[2] = {std::vector<double>(ids.size()), std::vector<double>(ids.size())};
+    std::vector<std::uint32_t> selected[2];
+    for (bool simd : {false, true}) {
+        DistanceKernel::enableSimd(simd);
+        DistanceKernel::squaredDistances(x.data(), y.data(), z.data(), ids.size(), query, distances[simd].data());
+        DistanceKernel::selectWithin(x.data(), y.data(), z.data(), ids.data(), ids.size(), query, 1.0, selected[simd]);
+    }
+    DistanceKernel::enableSimd(true);
+    BOOST_CHECK(distances[0] == distances[1]);  // Bitwise, not only close
+    BOOST_CHECK(selected[0] == selected[1]);
+    BOOST_CHECK(!selected[0].empty() && selected[0].size() < ids.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // spatial_index
+
+BOOST_AUTO_TEST_SUITE(by_year_ingest)
+
+BOOST_FIXTURE_TEST_CASE(by_year_ingest_transposes_and_spills, TempDir)
+{
+
+    // Two years, three stations. Rows of a year are ordered by date, not by station.
+    const std::vector<std::string> stations{"GME00102380", "GME00111445", "USW00094728"};
+    std::vector<std::string> years;
+    for (int year : {1990, 1991}) {
+        std::string text;
+        for (int day = 28; day >= 1; --day) {  // Descending, the ingest has to sort.
+            for (const std::string& station : stations) {
+                text += std::format("{},{}02{:02},TMAX,{},,,E,\n", station, year, day, day);
+                text += std::format("{},{}02{:02},TMIN,{},,,E,\n", station, year, day, -day);
+            }
+        }
+        text += "../../escape,19900101,TMAX,1,,,E,\nmalformed\n";
+        years.push_back((dir / std::format("{}.csv", year)).string());
+        std::ofstream(years.back(), std::ios::binary) << text;
+    }
+
+    // Tiny budget: every block spills. Large budget: everything stays in memory. Same result.
+    for (std::size_t memoryBudget : {std::size_t{1}, std::size_t{1} << 30}) {
+        const std::filesystem::path outputDir = dir / std::format("out_{}", memoryBudget);
+        ByYearIngest ingest(outputDir.string(), memoryBudget);
+        for (const std::string& year : years) {
+            BOOST_REQUIRE(ingest.addFile(year));
+        }
+        BOOST_REQUIRE(ingest.finish());
+        BOOST_CHECK_EQUAL(ingest.rowCount(), 2 * 28 * 3 * 2);
+        BOOST_CHECK_EQUAL(ingest.stationCount(), 3);
+        BOOST_CHECK_EQUAL(ingest.spillCount() > 0, memoryBudget == 1);
+        BOOST_CHECK(!std::filesystem::exists(outputDir / ".by_year_spill"));
+
+        for (const std::string& station : stations) {
+            const std::string filename = (outputDir / (station + ".csv")).string();
+            StationMeasurements stationMeasurements;
+            BOOST_REQUIRE(BinaryCache::read(BinaryCache::cacheFilenameFor(filename), filename, stationMeasurements));
+            auto tmax = stationMeasurements.series(MeasurementType::TMAX);
+            BOOST_REQUIRE_EQUAL(tmax.size(), 2 * 28);
+            BOOST_CHECK(std::ranges::is_sorted(tmax, {}, &Measurement::getPackedDate));
+            BOOST_CHECK_EQUAL(tmax.front().getYear(), 1990);
+            BOOST_CHECK_EQUAL(tmax.front().getDay(), 1);
+            BOOST_CHECK_EQUAL(tmax.back().getYear(), 1991);
+            BOOST_CHECK_EQUAL(stationMeasurements.series(MeasurementType::TMIN).size(), 2 * 28);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // by_year_ingest
+
+#ifdef GHCN_HAVE_ZLIB
+
+BOOST_AUTO_TEST_SUITE(gzip_reader)
+
+BOOST_FIXTURE_TEST_CASE(gzip_parse_equals_plain_parse, TempDir)
+{
+    const std::string source = (dir / "GMTEST000001.csv.gz").string();
+
+    // Several decompressed blocks, so lines are split across block boundaries.
+    std::string text;
+    for (int i = 0; text.size() < 3 * GzipReader::s_blockSize; ++i) {
+        text += std::format("GMTEST000001,{:04}{:02}{:02},{},{},,,E,\n", 1900 + i / 372, 1 + i / 31 % 12, 1 + i % 31,
+                            i % 2 ? "TMAX" : "PRCP", i % 1000 - 500);
+    }
+    text += "GMTEST000001,20240101,TMIN,-7,,,E,";  // No final line break
+
+    gzFile file = gzopen(source.c_str(), "wb");
+    BOOST_REQUIRE(file != nullptr);
+    BOOST_REQUIRE_EQUAL(gzwrite(file, text.data(), static_cast<unsigned>(text.size())), static_cast<int>(text.size()));
+    gzclose(file);
+
+    std::vector<Measurement> plain;
+    MeasurementParser::parseCsv(text, plain);
+    std::vector<Measurement> streamed;
+    BOOST_REQUIRE(MeasurementParser::parseGzip(source, streamed));
+    BOOST_REQUIRE_EQUAL(streamed.size(), plain.size());
+    for (std::size_t i = 0; i < plain.size(); ++i) {
+        BOOST_CHECK(streamed[i].getPackedDate() == plain[i].getPackedDate() &&
+                    streamed[i].getValue() == plain[i].getValue() &&
+                    streamed[i].getType() == plain[i].getType());
+    }
+
+    // Truncated file is reported.
+    std::filesystem::resize_file(source, std::filesystem::file_size(source) / 2);
+    streamed.clear();
+    BOOST_CHECK(!MeasurementParser::parseGzip(source, streamed));
+    BOOST_CHECK(!MeasurementParser::parseGzip((dir / "missing.csv.gz").string(), streamed));
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // gzip_reader
+
+#endif  // GHCN_HAVE_ZLIB